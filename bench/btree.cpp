@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "../source/btree.hpp"
+#include "../source/tree.hpp"
+
+typedef Rope::Rope<char> Tree;
+typedef Rope::BTree<char> BTree;
+
+template <typename TFunction>
+double measure(TFunction&& function) {
+    // the best of several runs hides page faults and frequency ramp up
+    double best = 1e30;
+
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+void report(const char* name, double rope, double btree) {
+    std::printf("%-24s %10.3f ms %10.3f ms %8.2fx\n", name, rope, btree, rope / btree);
+}
+
+template <typename TTree>
+void index(TTree& tree, size_t count, volatile size_t& sink) {
+    std::mt19937 random(2);
+
+    for (size_t i = 0; i < count; i++) {
+        sink = sink + tree[random() % tree.size()];
+    }
+}
+
+template <typename TTree>
+void insert(TTree& tree, size_t count) {
+    std::mt19937 random(3);
+    char word[] = "inserted";
+
+    for (size_t i = 0; i < count; i++) {
+        tree.insert(TTree(8, word), random() % tree.size());
+    }
+}
+
+template <typename TTree>
+void split(TTree& tree, size_t count) {
+    std::mt19937 random(4);
+
+    for (size_t i = 0; i < count; i++) {
+        auto [left, right] = tree.split(random() % tree.size());
+
+        left.append(std::move(right));
+        tree = std::move(left);
+    }
+}
+
+template <typename TTree>
+void iterate(TTree& tree, volatile size_t& sink) {
+    size_t total = 0;
+
+    tree.forEachChunk(0, tree.size(), [&](std::span<const char> chunk) {
+        for (char c : chunk) {
+            total += c;
+        }
+    });
+
+    sink = sink + total;
+}
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? std::stoull(argv[1]) : size_t(64) << 20;
+
+    std::mt19937 random(1);
+    std::string text(size, ' ');
+
+    for (char& c : text) {
+        c = 'a' + random() % 26;
+    }
+
+    Tree tree(text.size(), text.data());
+    BTree btree(text.size(), text.data());
+    volatile size_t sink = 0;
+
+    std::printf("%zu bytes, rope height %zu, btree height %zu\n", size, tree.height(), btree.height());
+    std::printf("%-24s %13s %13s %9s\n", "operation", "rope", "btree", "ratio");
+
+    report("index x1M",
+        measure([&] { index(tree, 1000000, sink); }),
+        measure([&] { index(btree, 1000000, sink); }));
+
+    report("insert x100k",
+        measure([&] { insert(tree, 100000); }),
+        measure([&] { insert(btree, 100000); }));
+
+    report("split + append x10k",
+        measure([&] { split(tree, 10000); }),
+        measure([&] { split(btree, 10000); }));
+
+    report("iterate",
+        measure([&] { iterate(tree, sink); }),
+        measure([&] { iterate(btree, sink); }));
+
+    return 0;
+}
@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../source/rope.hpp"
+
+/// The trace is a text file with one operation per line:
+///     i <offset> <length>    inserts the <length> bytes following the line break at the offset
+///     e <offset> <length>    erases <length> bytes at the offset
+///     r <offset>             reads the byte at the offset
+///     s <offset>             splits at the offset and joins both halves again
+///     f                      flattens the entire content into an array
+/// The payload of an insertion is followed by another line break
+/// Lines starting with # are comments
+
+/// An operation of the trace
+struct Operation {
+    /// The kind of the operation, one of i, e, r, s, f
+    char kind;
+    /// The offset of the operation
+    size_t offset;
+    /// The number of erased bytes
+    size_t length;
+    /// The inserted bytes
+    std::string payload;
+};
+
+/// Loads the trace at the provided path
+/// Throws a std::runtime_error if the trace is malformed or refers to offsets out of range
+std::vector<Operation> load(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error(std::string("cannot open ") + path);
+    }
+
+    std::vector<Operation> operations;
+    std::string line;
+    size_t size = 0;
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Operation operation = {line[0], 0, 0, {}};
+        int fields = std::sscanf(line.c_str() + 1, "%zu %zu", &operation.offset, &operation.length);
+        bool valid;
+
+        switch (operation.kind) {
+            case 'i':
+                operation.payload.resize(operation.length);
+                file.read(operation.payload.data(), operation.length);
+                file.ignore(1);
+
+                valid = fields == 2 && file && operation.offset <= size;
+                size += operation.length;
+                break;
+            case 'e':
+                valid = fields == 2 && operation.offset + operation.length <= size;
+                size -= std::min(size, operation.length);
+                break;
+            case 'r':
+                valid = fields == 1 && operation.offset < size;
+                break;
+            case 's':
+                valid = fields == 1 && operation.offset <= size;
+                break;
+            case 'f':
+                valid = true;
+                break;
+            default:
+                valid = false;
+        }
+
+        if (!valid) {
+            throw std::runtime_error("malformed operation " + std::to_string(operations.size()) + ": " + line);
+        }
+
+        operations.push_back(std::move(operation));
+    }
+
+    return operations;
+}
+
+/// Saves the trace to the provided path
+void save(const char* path, const std::vector<Operation>& operations) {
+    std::ofstream file(path, std::ios::binary);
+
+    for (const Operation& operation : operations) {
+        switch (operation.kind) {
+            case 'i':
+                file << "i " << operation.offset << ' ' << operation.payload.size() << '\n' << operation.payload << '\n';
+                break;
+            case 'e':
+                file << "e " << operation.offset << ' ' << operation.length << '\n';
+                break;
+            case 'r':
+            case 's':
+                file << operation.kind << ' ' << operation.offset << '\n';
+                break;
+            default:
+                file << operation.kind << '\n';
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error(std::string("cannot write ") + path);
+    }
+}
+
+/// Generates synthetic traces resembling editing sessions
+class Generator {
+    std::mt19937_64 random;
+    std::vector<Operation> operations;
+    size_t size;
+    size_t cursor;
+
+public:
+    explicit Generator(uint64_t seed)
+        : random(seed), size(0), cursor(0) {}
+
+    /// Generates the provided number of operations of the provided workload
+    /// typing: single characters and backspaces around a slowly moving cursor
+    /// paste:  large insertions and cuts of whole blocks at random positions
+    /// random: reads, small edits and splits spread over the entire content
+    std::vector<Operation> generate(const std::string& workload, size_t count) {
+        if (workload == "typing") {
+            insert(0, 1 << 16);
+
+            while (operations.size() < count) {
+                typing();
+            }
+        } else if (workload == "paste") {
+            insert(0, 1 << 20);
+
+            while (operations.size() < count) {
+                paste();
+            }
+        } else if (workload == "random") {
+            insert(0, 1 << 22);
+
+            while (operations.size() < count) {
+                access();
+            }
+        } else {
+            throw std::runtime_error("unknown workload " + workload);
+        }
+
+        return std::move(operations);
+    }
+
+private:
+    void typing() {
+        uint64_t choice = random() % 1000;
+
+        if (choice < 800) {
+            insert(cursor, 1);
+        } else if (choice < 950) {
+            if (cursor > 0) {
+                erase(cursor - 1, 1);
+            }
+        } else if (choice < 990) {
+            if (size > 0) {
+                read(std::min(cursor, size - 1));
+            }
+        } else if (choice < 999) {
+            // a jump to a nearby line
+            size_t step = random() % 4096;
+            cursor = std::min(cursor + step >= 2048 ? cursor + step - 2048 : 0, size);
+        } else {
+            flatten();
+        }
+    }
+
+    void paste() {
+        uint64_t choice = random() % 100;
+        size_t length = 256 + random() % (1 << 14);
+
+        // as many bytes are cut as pasted to keep the size stable
+        if (choice < 45) {
+            insert(random() % (size + 1), length);
+        } else if (choice < 90) {
+            length = std::min(length, size / 2);
+            erase(random() % (size - length + 1), length);
+        } else if (choice < 99) {
+            split(random() % (size + 1));
+        } else {
+            flatten();
+        }
+    }
+
+    void access() {
+        uint64_t choice = random() % 100;
+
+        if (choice < 70) {
+            read(random() % size);
+        } else if (choice < 85) {
+            insert(random() % (size + 1), 1 + random() % 16);
+        } else if (choice < 97) {
+            size_t length = std::min<size_t>(1 + random() % 16, size);
+            erase(random() % (size - length + 1), length);
+        } else {
+            split(random() % (size + 1));
+        }
+    }
+
+    void insert(size_t offset, size_t length) {
+        std::string payload(length, ' ');
+
+        for (char& c : payload) {
+            c = random() % 32 == 0 ? '\n' : 'a' + random() % 26;
+        }
+
+        operations.push_back({'i', offset, length, std::move(payload)});
+        size += length;
+        cursor = offset + length;
+    }
+
+    void erase(size_t offset, size_t length) {
+        operations.push_back({'e', offset, length, {}});
+        size -= length;
+        cursor = offset;
+    }
+
+    void read(size_t offset) {
+        operations.push_back({'r', offset, 0, {}});
+    }
+
+    void split(size_t offset) {
+        operations.push_back({'s', offset, 0, {}});
+    }
+
+    void flatten() {
+        operations.push_back({'f', 0, 0, {}});
+    }
+};
+
+/// The operations on std::string
+struct String {
+    typedef std::string Type;
+
+    static Type create() {
+        return Type();
+    }
+
+    static void insert(Type& string, size_t offset, const std::string& payload) {
+        string.insert(offset, payload);
+    }
+
+    static void erase(Type& string, size_t offset, size_t length) {
+        string.erase(offset, length);
+    }
+
+    static char read(const Type& string, size_t offset) {
+        return string[offset];
+    }
+
+    static void split(Type& string, size_t offset) {
+        Type right = string.substr(offset);
+
+        string.resize(offset);
+        string += right;
+    }
+
+    static char* flatten(const Type& string) {
+        char* result = new char[string.size()];
+
+        std::memcpy(result, string.data(), string.size());
+        return result;
+    }
+};
+
+/// The operations on Rope::Rope with the provided allocator
+/// Util::Rope wraps the pooled one, so it has no row of its own
+template <typename TAllocator>
+struct Tree {
+    typedef Rope::Rope<char, 1024, Rope::Summary::None, TAllocator> Type;
+
+    static Type create() {
+        return Type();
+    }
+
+    static void insert(Type& tree, size_t offset, const std::string& payload) {
+        tree.insert(Type(payload.size(), const_cast<char*>(payload.data())), offset);
+    }
+
+    static void erase(Type& tree, size_t offset, size_t length) {
+        tree.remove(offset, offset + length);
+    }
+
+    static char read(const Type& tree, size_t offset) {
+        return tree[offset];
+    }
+
+    static void split(Type& tree, size_t offset) {
+        auto [left, right] = tree.split(offset);
+
+        left.append(std::move(right));
+        tree = std::move(left);
+    }
+
+    static char* flatten(const Type& tree) {
+        return tree.array();
+    }
+};
+
+/// Replays the trace, prints the latency percentiles of every kind of operation
+/// and returns the final content
+template <typename TAdapter>
+std::string replay(const char* name, const std::vector<Operation>& operations) {
+    typename TAdapter::Type subject = TAdapter::create();
+    std::map<char, std::vector<double>> latencies;
+    volatile size_t sink = 0;
+
+    auto total = std::chrono::steady_clock::now();
+
+    for (const Operation& operation : operations) {
+        auto start = std::chrono::steady_clock::now();
+
+        switch (operation.kind) {
+            case 'i':
+                TAdapter::insert(subject, operation.offset, operation.payload);
+                break;
+            case 'e':
+                TAdapter::erase(subject, operation.offset, operation.length);
+                break;
+            case 'r':
+                sink = sink + TAdapter::read(subject, operation.offset);
+                break;
+            case 's':
+                TAdapter::split(subject, operation.offset);
+                break;
+            case 'f': {
+                char* array = TAdapter::flatten(subject);
+                sink = sink + (subject.size() > 0 ? array[0] : 0);
+                delete[] array;
+                break;
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        latencies[operation.kind].push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - total).count();
+
+    for (auto& [kind, times] : latencies) {
+        std::sort(times.begin(), times.end());
+
+        auto percentile = [&](double rank) {
+            return times[std::min(times.size() - 1, size_t(rank * times.size()))];
+        };
+
+        std::printf("%-12s %c %10zu %12.0f %12.0f %12.0f %12.0f\n",
+            name, kind, times.size(), percentile(0.5), percentile(0.99), percentile(0.999), times.back());
+    }
+
+    std::printf("%-12s total %.3f ms\n", name, elapsed);
+
+    char* content = TAdapter::flatten(subject);
+    std::string result(content, subject.size());
+
+    delete[] content;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc == 5 && std::strcmp(argv[1], "generate") == 0) {
+            save(argv[4], Generator(1).generate(argv[2], std::stoull(argv[3])));
+            return 0;
+        }
+
+        if (argc != 2) {
+            std::fprintf(stderr, "usage: %s <trace>\n       %s generate <typing|paste|random> <operations> <trace>\n", argv[0], argv[0]);
+            return 2;
+        }
+
+        std::vector<Operation> operations = load(argv[1]);
+
+        std::printf("%s: %zu operations\n", argv[1], operations.size());
+        std::printf("%-12s %c %10s %12s %12s %12s %12s\n", "structure", 'k', "count", "p50 ns", "p99 ns", "p999 ns", "max ns");
+
+        std::string expected = replay<String>("std::string", operations);
+        bool equal = replay<Tree<Rope::PoolAllocator<>>>("Rope pooled", operations) == expected;
+        equal = replay<Tree<Rope::HeapAllocator>>("Rope heap", operations) == expected && equal;
+
+        if (!equal) {
+            std::fprintf(stderr, "%s: the final contents differ\n", argv[1]);
+            return 1;
+        }
+    } catch (const std::exception& exception) {
+        std::fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../source/rope.hpp"
+
+/// The number of heap allocations made by the process
+/// The pools only reach the heap when they grow by a slab, so pooled nodes are mostly not counted
+std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* pointer = std::malloc(std::max<size_t>(size, 1))) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    size_t align = static_cast<size_t>(alignment);
+
+    if (void* pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+// not inlined, so the compiler does not pair the free with the operator new of the caller
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept {
+    ::operator delete(pointer, alignment);
+}
+
+/// The pool allocator counting the nodes it creates
+/// Pooled nodes rarely reach the global operator new, so they are counted here instead
+struct CountingAllocator : Rope::PoolAllocator<> {
+    static inline std::atomic<size_t> count = 0;
+
+    template <typename T>
+    static T* create() {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return PoolAllocator::create<T>();
+    }
+};
+
+/// The number of runs of which the best is reported
+constexpr int Repeats = 3;
+
+/// The number of random reads
+constexpr size_t Reads = size_t(1) << 18;
+
+/// The number of bytes the linear baselines may move per operation and run
+constexpr size_t Budget = size_t(1) << 30;
+
+/// The data inserted and appended by the edits
+char word[] = "inserted";
+
+/// The operations on std::string and std::vector
+template <typename TSequence>
+struct Sequence {
+    typedef TSequence Type;
+
+    /// The sequences have no nodes to count
+    static constexpr bool Nodes = false;
+
+    static Type create(const std::string& text) {
+        return Type(text.begin(), text.end());
+    }
+
+    static char get(const Type& sequence, size_t index) {
+        return sequence[index];
+    }
+
+    static size_t sum(const Type& sequence) {
+        size_t total = 0;
+
+        for (char c : sequence) {
+            total += c;
+        }
+
+        return total;
+    }
+
+    static void insert(Type& sequence, size_t index, char* data, size_t size) {
+        sequence.insert(sequence.begin() + index, data, data + size);
+    }
+
+    static void erase(Type& sequence, size_t begin, size_t end) {
+        sequence.erase(sequence.begin() + begin, sequence.begin() + end);
+    }
+
+    static void split(Type& sequence, size_t index) {
+        Type right(sequence.begin() + index, sequence.end());
+
+        sequence.erase(sequence.begin() + index, sequence.end());
+        sequence.insert(sequence.end(), right.begin(), right.end());
+    }
+
+    static char* flatten(const Type& sequence) {
+        char* result = new char[sequence.size()];
+
+        std::copy(sequence.begin(), sequence.end(), result);
+        return result;
+    }
+};
+
+/// The operations on Rope::Rope with the provided leaf size
+/// Util::Rope wraps Rope<1024> with the same allocator, so it has no row of its own
+template <size_t TDataSize>
+struct Tree {
+    typedef Rope::Rope<char, TDataSize, Rope::Summary::None, CountingAllocator> Type;
+
+    /// The nodes are counted by CountingAllocator
+    static constexpr bool Nodes = true;
+
+    static Type create(const std::string& text) {
+        return Type(text.size(), const_cast<char*>(text.data()));
+    }
+
+    static char get(const Type& tree, size_t index) {
+        return tree[index];
+    }
+
+    static size_t sum(const Type& tree) {
+        size_t total = 0;
+
+        tree.forEachChunk(0, tree.size(), [&](std::span<const char> chunk) {
+            for (char c : chunk) {
+                total += c;
+            }
+        });
+
+        return total;
+    }
+
+    static void insert(Type& tree, size_t index, char* data, size_t size) {
+        tree.insert(Type(size, data), index);
+    }
+
+    static void erase(Type& tree, size_t begin, size_t end) {
+        tree.remove(begin, end);
+    }
+
+    static void split(Type& tree, size_t index) {
+        auto [left, right] = tree.split(index);
+
+        left.append(std::move(right));
+        tree = std::move(left);
+    }
+
+    static char* flatten(const Type& tree) {
+        return tree.array();
+    }
+};
+
+/// The positions of the edits
+/// Random positions are spread over the whole data, clustered ones drift
+/// around a cursor like the edits of someone typing
+class Positions {
+    std::mt19937_64 random;
+    bool clustered;
+    size_t cursor;
+
+public:
+    Positions(bool clustered, size_t size)
+        : random(7), clustered(clustered), cursor(size / 2) {}
+
+    size_t next(size_t limit) {
+        if (!clustered) {
+            return random() % (limit + 1);
+        }
+
+        size_t step = random() % 64;
+
+        cursor = std::min(cursor + step >= 32 ? cursor + step - 32 : 0, limit);
+
+        return cursor;
+    }
+};
+
+/// Runs the operation on a fresh structure for every run and returns the best time per operation
+/// The created nodes and heap allocations per operation of the best run are stored in nodes and allocated
+template <typename TAdapter, typename TOperation>
+double measure(const std::string& text, size_t count, TOperation&& operation, double& nodes, double& allocated) {
+    double best = 1e30;
+
+    for (int run = 0; run < Repeats; run++) {
+        typename TAdapter::Type subject = TAdapter::create(text);
+        size_t created = CountingAllocator::count.load(std::memory_order_relaxed);
+        size_t before = allocations.load(std::memory_order_relaxed);
+
+        auto start = std::chrono::steady_clock::now();
+        operation(subject);
+        auto end = std::chrono::steady_clock::now();
+
+        double time = std::chrono::duration<double, std::nano>(end - start).count() / count;
+
+        if (time < best) {
+            best = time;
+            nodes = double(CountingAllocator::count.load(std::memory_order_relaxed) - created) / count;
+            allocated = double(allocations.load(std::memory_order_relaxed) - before) / count;
+        }
+    }
+
+    return best;
+}
+
+std::string format(size_t size) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    int unit = 0;
+
+    while (size >= 1024 && size % 1024 == 0 && unit < 3) {
+        size /= 1024;
+        unit++;
+    }
+
+    return std::to_string(size) + " " + units[unit];
+}
+
+/// Runs every operation on the provided structure and prints a row per operation
+template <typename TAdapter>
+void run(const char* name, const std::string& text) {
+    typedef typename TAdapter::Type Type;
+
+    size_t size = text.size();
+    size_t edits = std::min(std::clamp<size_t>(Budget / size, 16, 65536), size / 16);
+    size_t copies = std::clamp<size_t>(Budget / size, 1, 4096);
+    volatile size_t sink = 0;
+
+    auto report = [&](const char* operation, size_t count, auto&& function) {
+        double nodes = 0;
+        double allocated = 0;
+        double time = measure<TAdapter>(text, count, function, nodes, allocated);
+
+        if constexpr (TAdapter::Nodes) {
+            std::printf("%-8s %-14s %-18s %12.1f %12.3f %12.3f\n", format(size).c_str(), name, operation, time, nodes, allocated);
+        } else {
+            std::printf("%-8s %-14s %-18s %12.1f %12s %12.3f\n", format(size).c_str(), name, operation, time, "-", allocated);
+        }
+    };
+
+    report("index", Reads, [&](Type& subject) {
+        std::mt19937_64 random(2);
+
+        for (size_t i = 0; i < Reads; i++) {
+            sink = sink + TAdapter::get(subject, random() % size);
+        }
+    });
+
+    report("iterate", size, [&](Type& subject) {
+        sink = sink + TAdapter::sum(subject);
+    });
+
+    report("append", edits, [&](Type& subject) {
+        for (size_t i = 0; i < edits; i++) {
+            TAdapter::insert(subject, subject.size(), word, 8);
+        }
+    });
+
+    for (bool clustered : {false, true}) {
+        report(clustered ? "insert clustered" : "insert random", edits, [&](Type& subject) {
+            Positions positions(clustered, size);
+
+            for (size_t i = 0; i < edits; i++) {
+                TAdapter::insert(subject, positions.next(subject.size()), word, 8);
+            }
+        });
+
+        report(clustered ? "erase clustered" : "erase random", edits, [&](Type& subject) {
+            Positions positions(clustered, size);
+
+            for (size_t i = 0; i < edits; i++) {
+                size_t index = positions.next(subject.size() - 8);
+                TAdapter::erase(subject, index, index + 8);
+            }
+        });
+    }
+
+    report("split + append", edits, [&](Type& subject) {
+        std::mt19937_64 random(4);
+
+        for (size_t i = 0; i < edits; i++) {
+            TAdapter::split(subject, random() % (size + 1));
+        }
+    });
+
+    report("copy", copies, [&](Type& subject) {
+        for (size_t i = 0; i < copies; i++) {
+            Type copy(subject);
+            sink = sink + copy.size();
+        }
+    });
+
+    report("flatten", copies, [&](Type& subject) {
+        for (size_t i = 0; i < copies; i++) {
+            char* array = TAdapter::flatten(subject);
+
+            sink = sink + array[size / 2];
+            delete[] array;
+        }
+    });
+}
+
+/// Runs the structure in a child process to report its own peak resident set size
+template <typename TAdapter>
+void isolate(const char* name, const std::string& text) {
+    std::fflush(stdout);
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        run<TAdapter>(name, text);
+        std::fflush(stdout);
+        _exit(0);
+    }
+
+    int status;
+    rusage usage;
+
+    wait4(pid, &status, 0, &usage);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::printf("%-8s %-14s failed\n", format(text.size()).c_str(), name);
+    } else {
+        std::printf("%-8s %-14s %-18s %12.1f MB\n", format(text.size()).c_str(), name, "peak RSS", usage.ru_maxrss / 1024.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t limit = argc > 1 ? std::stoull(argv[1]) : size_t(1) << 30;
+
+    std::printf("%-8s %-14s %-18s %12s %12s %12s\n", "size", "structure", "operation", "ns/op", "nodes/op", "heap/op");
+    std::printf("nodes/op counts the rope nodes created, heap/op the calls to the global operator new,\n");
+    std::printf("which pooled nodes only reach when a pool grows\n");
+    std::printf("peak RSS includes the source text of the given size\n");
+
+    for (size_t size = 1024; size <= limit; size *= 16) {
+        std::mt19937 random(1);
+        std::string text(size, ' ');
+
+        for (char& c : text) {
+            c = 'a' + random() % 26;
+        }
+
+        isolate<Sequence<std::string>>("std::string", text);
+        isolate<Sequence<std::vector<char>>>("std::vector", text);
+        isolate<Tree<64>>("Rope<64>", text);
+        isolate<Tree<256>>("Rope<256>", text);
+        isolate<Tree<1024>>("Rope<1024>", text);
+        isolate<Tree<4096>>("Rope<4096>", text);
+        isolate<Tree<16384>>("Rope<16384>", text);
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "../source/tree.hpp"
+
+typedef Rope::Rope<char> Tree;
+
+template <typename TFunction>
+double measure(TFunction&& function) {
+    // the best of several runs hides page faults and frequency ramp up
+    double best = 1e30;
+
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+void report(const char* name, double rope, double string) {
+    std::printf("%-24s %10.3f ms %10.3f ms %8.2fx\n", name, rope, string, rope / string);
+}
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? std::stoull(argv[1]) : size_t(64) << 20;
+
+    std::mt19937 random(1);
+    std::string text(size, ' ');
+
+    for (char& c : text) {
+        c = 'a' + random() % 26;
+    }
+
+    std::string needle = text.substr(size - 64, 32);
+    std::string early = text.substr(64, 32);
+    text[size - 1] = '#';
+
+    Tree tree(text.size(), text.data());
+    volatile size_t sink = 0;
+
+    std::printf("%zu bytes, tree height %zu\n", size, tree.height());
+    std::printf("%-24s %13s %13s %9s\n", "operation", "rope", "string", "ratio");
+
+    report("find(value)",
+        measure([&] { sink = sink + tree.find('#'); }),
+        measure([&] { sink = sink + text.find('#'); }));
+
+    report("rfind(value)",
+        measure([&] { sink = sink + tree.rfind('#', size - 2); }),
+        measure([&] { sink = sink + text.rfind('#', size - 2); }));
+
+    report("count(value)",
+        measure([&] { sink = sink + tree.count('e'); }),
+        measure([&] { sink = sink + std::count(text.begin(), text.end(), 'e'); }));
+
+    report("find(needle)",
+        measure([&] { sink = sink + tree.find(std::span<const char>(needle)); }),
+        measure([&] { sink = sink + text.find(needle); }));
+
+    report("rfind(needle)",
+        measure([&] { sink = sink + tree.rfind(std::span<const char>(early)); }),
+        measure([&] { sink = sink + text.rfind(early); }));
+
+    report("flatten + find(value)",
+        measure([&] {
+            char* data = tree.array();
+            sink = sink + std::string_view(data, size).find('#');
+            delete[] data;
+        }),
+        measure([&] { sink = sink + text.find('#'); }));
+
+    return 0;
+}
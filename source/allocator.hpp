@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+/// The rope namespace
+namespace Rope {
+
+/// A pool of fixed size chunks carved from large slabs
+/// Every thread keeps a cache of free chunks in front of the shared free list
+template <size_t TChunkSize, size_t TAlignment = alignof(std::max_align_t), size_t TCacheSize = 64>
+class Pool {
+    /// The free chunk
+    struct Chunk {
+        /// The next free chunk
+        Chunk* next;
+    };
+
+    /// The alignment of a chunk
+    static constexpr size_t Alignment = std::max(TAlignment, alignof(Chunk));
+    /// The size of a chunk rounded up to the alignment
+    static constexpr size_t ChunkSize = (std::max(TChunkSize, sizeof(Chunk)) + Alignment - 1) & ~(Alignment - 1);
+    /// The number of chunks a full cache keeps when trimmed
+    static constexpr size_t CacheKeep = (TCacheSize + 1) / 2;
+    /// The number of chunks in a slab
+    static constexpr size_t SlabChunks = std::max<size_t>(16, (size_t(1) << 20) / ChunkSize);
+
+    /// The free list shared by all threads
+    struct Shared {
+        /// The mutex guarding the free list
+        std::mutex mutex;
+        /// The first free chunk
+        Chunk* free = nullptr;
+    };
+
+    /// The free list of a single thread
+    struct Cache {
+        /// The first free chunk
+        Chunk* free = nullptr;
+        /// The number of free chunks
+        size_t count = 0;
+
+        /// Returns the cached chunks to the shared free list
+        ~Cache();
+    };
+
+public:
+    /// Allocates a chunk
+    static void* allocate();
+
+    /// Deallocates a chunk previously allocated by this pool
+    static void deallocate(void* pointer);
+
+private:
+    static Shared& shared();
+
+    static Cache& cache();
+
+    static Chunk* refill(size_t count);
+
+    static void release(Chunk* first, Chunk* last);
+};
+
+/// The allocator using the global heap
+struct HeapAllocator {
+    /// Allocates a value initialized T
+    template <typename T>
+    static T* create();
+
+    /// Destroys a T previously created by this allocator
+    template <typename T>
+    static void destroy(T* value);
+
+    /// Allocates a default constructed array of TCount elements
+    template <typename T, size_t TCount>
+    static T* allocate();
+
+    /// Deallocates an array previously allocated by this allocator
+    template <typename T, size_t TCount>
+    static void deallocate(T* data);
+};
+
+/// The allocator using a pool for every object and array size
+/// The pools are shared by all ropes, so nodes can be handed between ropes
+/// There is no bulk release, clearing or destroying a rope returns its nodes one by one,
+/// since nodes shared with other ropes through copies must outlive it
+template <size_t TCacheSize = 64>
+struct PoolAllocator {
+    /// Allocates a value initialized T
+    template <typename T>
+    static T* create();
+
+    /// Destroys a T previously created by this allocator
+    template <typename T>
+    static void destroy(T* value);
+
+    /// Allocates a default constructed array of TCount elements
+    template <typename T, size_t TCount>
+    static T* allocate();
+
+    /// Deallocates an array previously allocated by this allocator
+    template <typename T, size_t TCount>
+    static void deallocate(T* data);
+};
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+Pool<TChunkSize, TAlignment, TCacheSize>::Cache::~Cache() {
+    if (free != nullptr) {
+        Chunk* last = free;
+
+        while (last->next != nullptr) {
+            last = last->next;
+        }
+
+        release(free, last);
+    }
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+void* Pool<TChunkSize, TAlignment, TCacheSize>::allocate() {
+    if constexpr (TCacheSize == 0) {
+        return refill(1);
+    } else {
+        Cache& cache = Pool::cache();
+
+        if (cache.free == nullptr) {
+            cache.free = refill(CacheKeep);
+            cache.count = CacheKeep;
+        }
+
+        Chunk* chunk = cache.free;
+
+        cache.free = chunk->next;
+        cache.count -= 1;
+
+        return chunk;
+    }
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+void Pool<TChunkSize, TAlignment, TCacheSize>::deallocate(void* pointer) {
+    Chunk* chunk = static_cast<Chunk*>(pointer);
+
+    if constexpr (TCacheSize == 0) {
+        chunk->next = nullptr;
+        release(chunk, chunk);
+    } else {
+        Cache& cache = Pool::cache();
+
+        chunk->next = cache.free;
+        cache.free = chunk;
+        cache.count += 1;
+
+        if (cache.count > TCacheSize) {
+            // keep the first half cached and hand the second half back
+            Chunk* last = cache.free;
+
+            for (size_t i = 1; i < CacheKeep; i++) {
+                last = last->next;
+            }
+
+            Chunk* first = last->next;
+
+            last->next = nullptr;
+            last = first;
+
+            while (last->next != nullptr) {
+                last = last->next;
+            }
+
+            release(first, last);
+            cache.count = CacheKeep;
+        }
+    }
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+Pool<TChunkSize, TAlignment, TCacheSize>::Shared& Pool<TChunkSize, TAlignment, TCacheSize>::shared() {
+    // the slabs live until the process exits, chunks may outlive every thread
+    static Shared* shared = new Shared();
+    return *shared;
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+Pool<TChunkSize, TAlignment, TCacheSize>::Cache& Pool<TChunkSize, TAlignment, TCacheSize>::cache() {
+    thread_local Cache cache;
+    return cache;
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+Pool<TChunkSize, TAlignment, TCacheSize>::Chunk* Pool<TChunkSize, TAlignment, TCacheSize>::refill(size_t count) {
+    Shared& shared = Pool::shared();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    Chunk* first = nullptr;
+
+    for (size_t i = 0; i < count; i++) {
+        if (shared.free == nullptr) {
+            char* slab = static_cast<char*>(::operator new(SlabChunks * ChunkSize, std::align_val_t(Alignment)));
+
+            for (size_t j = 0; j < SlabChunks; j++) {
+                Chunk* chunk = reinterpret_cast<Chunk*>(slab + j * ChunkSize);
+
+                chunk->next = shared.free;
+                shared.free = chunk;
+            }
+        }
+
+        Chunk* chunk = shared.free;
+
+        shared.free = chunk->next;
+        chunk->next = first;
+        first = chunk;
+    }
+
+    return first;
+}
+
+template <size_t TChunkSize, size_t TAlignment, size_t TCacheSize>
+void Pool<TChunkSize, TAlignment, TCacheSize>::release(Chunk* first, Chunk* last) {
+    Shared& shared = Pool::shared();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    last->next = shared.free;
+    shared.free = first;
+}
+
+template <typename T>
+T* HeapAllocator::create() {
+    return new T();
+}
+
+template <typename T>
+void HeapAllocator::destroy(T* value) {
+    delete value;
+}
+
+template <typename T, size_t TCount>
+T* HeapAllocator::allocate() {
+    return new T[TCount];
+}
+
+template <typename T, size_t TCount>
+void HeapAllocator::deallocate(T* data) {
+    delete[] data;
+}
+
+template <size_t TCacheSize>
+template <typename T>
+T* PoolAllocator<TCacheSize>::create() {
+    return new (Pool<sizeof(T), alignof(T), TCacheSize>::allocate()) T();
+}
+
+template <size_t TCacheSize>
+template <typename T>
+void PoolAllocator<TCacheSize>::destroy(T* value) {
+    value->~T();
+    Pool<sizeof(T), alignof(T), TCacheSize>::deallocate(value);
+}
+
+template <size_t TCacheSize>
+template <typename T, size_t TCount>
+T* PoolAllocator<TCacheSize>::allocate() {
+    T* data = static_cast<T*>(Pool<sizeof(T) * TCount, alignof(T), TCacheSize>::allocate());
+    std::uninitialized_default_construct_n(data, TCount);
+
+    return data;
+}
+
+template <size_t TCacheSize>
+template <typename T, size_t TCount>
+void PoolAllocator<TCacheSize>::deallocate(T* data) {
+    std::destroy_n(data, TCount);
+    Pool<sizeof(T) * TCount, alignof(T), TCacheSize>::deallocate(data);
+}
+
+} // namespace Rope
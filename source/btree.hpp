@@ -0,0 +1,734 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "allocator.hpp"
+#include "search.hpp"
+
+/// The rope namespace
+namespace Rope {
+
+/// The rope data structure as a B+-tree with fixed size leaves
+/// Inner nodes keep up to TFanout children and the prefix sums of their sizes
+/// in a cache line aligned array, every leaf is at the same depth
+/// Unlike Rope, copies do not share nodes and no summary is kept
+template <typename TData, size_t TDataSize = 1024, size_t TFanout = 16, typename TAllocator = PoolAllocator<>>
+class BTree {
+    typedef BTree<TData, TDataSize, TFanout, TAllocator> TTree;
+
+    /// The minimum size of a leaf that is not the only leaf
+    static constexpr size_t MinSize = TDataSize >> 2;
+    /// The capacity of a leaf
+    static constexpr size_t MaxSize = TDataSize;
+    /// The minimum number of children of an inner node joined with a sibling
+    static constexpr size_t MinFanout = TFanout / 2;
+    /// The prefix sum of the unused children, above every index
+    static constexpr uint64_t Padding = INT64_MAX;
+
+    static_assert(MinSize > 0, "TDataSize must be at least 4");
+    static_assert(TFanout >= 4, "TFanout must be at least 4");
+
+    /// The base struct for inner and outer nodes
+    struct Node {
+        /// True if it is an inner node
+        bool inner;
+        /// The height of the subtree, zero for outer nodes
+        uint8_t height;
+
+        /// The size of the subtree
+        size_t size;
+    };
+
+    /// The inner node
+    struct Inner : Node {
+        /// The number of children
+        size_t count;
+        /// The size of the children up to and including each child
+        alignas(64) uint64_t sizes[TFanout];
+        /// The children of the inner node
+        Node* children[TFanout];
+    };
+
+    /// The outer node
+    struct Outer : Node {
+        /// The data of the node with a capacity of MaxSize
+        TData* data;
+    };
+
+    /// The root node, null if the tree is empty
+    Node* root;
+
+    /// Constructs a tree with the provided root, which may be null
+    BTree(Node* root);
+
+public:
+    /// Constructs an empty tree
+    BTree();
+
+    /// Constructs a balanced tree by copying the provided data in linear time
+    BTree(size_t size, TData* data);
+
+    /// The destructor
+    ~BTree();
+
+    /// The copy constructor
+    BTree(const TTree& other);
+
+    /// The move constructor
+    BTree(TTree&& other);
+
+    /// The copy assignment operator
+    TTree& operator=(const TTree& other);
+
+    /// The move assignment operator
+    TTree& operator=(TTree&& other);
+
+    /// The index operator
+    TData& operator[](size_t index);
+
+    /// The const index operator
+    const TData& operator[](size_t index) const;
+
+    /// Returns the data at the specified index
+    TData& at(size_t index);
+
+    /// Returns the const data at the specified index
+    const TData& at(size_t index) const;
+
+    /// Creates an array containing the entire data of the tree
+    TData* array() const;
+
+    /// Appends the other tree to this tree
+    void append(TTree&& other);
+
+    /// Inserts the other tree at the specified index
+    void insert(TTree&& other, size_t index);
+
+    /// Removes the data between the provided indices
+    void remove(size_t begin, size_t end);
+
+    /// Splits the tree at the specified index and empties this tree
+    std::pair<TTree, TTree> split(size_t index);
+
+    /// Clears the tree
+    void clear();
+
+    /// Returns the size of the tree
+    size_t size() const;
+
+    /// Returns the height of the tree
+    size_t height() const;
+
+    /// Calls the function with the data of every leaf between the provided indices
+    /// The function may return false to stop, in which case false is returned
+    template <typename TFunction>
+    bool forEachChunk(size_t begin, size_t end, TFunction&& function) const;
+
+private:
+    static Inner* createInner();
+
+    static Outer* createOuter(size_t size, const TData* data);
+
+    static void destroy(Node* node);
+
+    static Node* clone(const Node* node);
+
+    static void update(Inner* inner);
+
+    static size_t select(const Inner* inner, size_t index);
+
+    static size_t offset(const Inner* inner, size_t child);
+
+    static TData& at(Node* node, size_t index);
+
+    static void array(const Node* node, TData* array);
+
+    template <typename TFunction>
+    static bool forEachChunk(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function);
+
+    static Inner* insertChild(Inner* inner, size_t position, Node* child);
+
+    static std::pair<Node*, Node*> merge(Node* left, Node* right);
+
+    static std::pair<Node*, Node*> joinNodes(Node* left, Node* right);
+
+    static Node* join(Node* left, Node* right);
+
+    static std::pair<Node*, Node*> split(Node* node, size_t index);
+
+    static Node* group(std::span<Node*> nodes);
+};
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::BTree(Node* root)
+    : root(root)
+{
+    // empty
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::BTree()
+    : root(nullptr)
+{
+    // empty
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::BTree(size_t size, TData* data)
+    : root(nullptr)
+{
+    if (size == 0) {
+        return;
+    }
+
+    // spread the data evenly, so every leaf holds at least half of MaxSize
+    size_t count = (size + MaxSize - 1) / MaxSize;
+    std::vector<Node*> nodes(count);
+
+    for (size_t i = 0, index = 0; i < count; i++) {
+        size_t leaf = size / count + (i < size % count);
+
+        nodes[i] = createOuter(leaf, data + index);
+        index += leaf;
+    }
+
+    while (nodes.size() > 1) {
+        // spread the children evenly, so every node has at least MinFanout children
+        size_t parents = (nodes.size() + TFanout - 1) / TFanout;
+        std::vector<Node*> next(parents);
+
+        for (size_t i = 0, index = 0; i < parents; i++) {
+            size_t children = nodes.size() / parents + (i < nodes.size() % parents);
+
+            next[i] = group(std::span<Node*>(nodes.data() + index, children));
+            index += children;
+        }
+
+        nodes = std::move(next);
+    }
+
+    root = nodes[0];
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::~BTree() {
+    destroy(root);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::BTree(const TTree& other)
+    : root(clone(other.root))
+{
+    // empty
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::BTree(TTree&& other)
+    : root(other.root)
+{
+    other.root = nullptr;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>& BTree<TData, TDataSize, TFanout, TAllocator>::operator=(const TTree& other) {
+    if (this != &other) {
+        destroy(root);
+        root = clone(other.root);
+    }
+
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>& BTree<TData, TDataSize, TFanout, TAllocator>::operator=(TTree&& other) {
+    if (this != &other) {
+        std::swap(root, other.root);
+    }
+
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+TData& BTree<TData, TDataSize, TFanout, TAllocator>::operator[](size_t index) {
+    return at(root, index);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+const TData& BTree<TData, TDataSize, TFanout, TAllocator>::operator[](size_t index) const {
+    return at(root, index);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+TData& BTree<TData, TDataSize, TFanout, TAllocator>::at(size_t index) {
+    return at(root, index);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+const TData& BTree<TData, TDataSize, TFanout, TAllocator>::at(size_t index) const {
+    return at(root, index);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+TData* BTree<TData, TDataSize, TFanout, TAllocator>::array() const {
+    TData* result = new TData[size()];
+
+    if (root != nullptr) {
+        array(root, result);
+    }
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::append(TTree&& other) {
+    if (this != &other) {
+        root = join(root, other.root);
+        other.root = nullptr;
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::insert(TTree&& other, size_t index) {
+    if (this != &other) {
+        auto [left, right] = split(root, index);
+
+        root = join(join(left, other.root), right);
+        other.root = nullptr;
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::remove(size_t begin, size_t end) {
+    if (begin < end) {
+        auto [left, rest] = split(root, begin);
+        auto [center, right] = split(rest, end - begin);
+
+        destroy(center);
+        root = join(left, right);
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+std::pair<BTree<TData, TDataSize, TFanout, TAllocator>, BTree<TData, TDataSize, TFanout, TAllocator>> BTree<TData, TDataSize, TFanout, TAllocator>::split(size_t index) {
+    auto [left, right] = split(root, index);
+    root = nullptr;
+
+    return std::make_pair(TTree(left), TTree(right));
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::clear() {
+    destroy(root);
+    root = nullptr;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+size_t BTree<TData, TDataSize, TFanout, TAllocator>::size() const {
+    return root == nullptr ? 0 : root->size;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+size_t BTree<TData, TDataSize, TFanout, TAllocator>::height() const {
+    return root == nullptr ? 0 : root->height;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+template <typename TFunction>
+bool BTree<TData, TDataSize, TFanout, TAllocator>::forEachChunk(size_t begin, size_t end, TFunction&& function) const {
+    end = std::min(end, size());
+    return begin >= end || forEachChunk(root, 0, begin, end, function);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Inner* BTree<TData, TDataSize, TFanout, TAllocator>::createInner() {
+    Inner* inner = TAllocator::template create<Inner>();
+
+    inner->inner = true;
+    inner->count = 0;
+
+    std::fill(inner->sizes, inner->sizes + TFanout, Padding);
+    return inner;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Outer* BTree<TData, TDataSize, TFanout, TAllocator>::createOuter(size_t size, const TData* data) {
+    Outer* outer = TAllocator::template create<Outer>();
+
+    outer->inner = false;
+    outer->height = 0;
+    outer->size = size;
+    outer->data = TAllocator::template allocate<TData, MaxSize>();
+
+    std::copy(data, data + size, outer->data);
+    return outer;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::destroy(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+
+        for (size_t i = 0; i < inner->count; i++) {
+            destroy(inner->children[i]);
+        }
+
+        TAllocator::destroy(inner);
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+
+        TAllocator::template deallocate<TData, MaxSize>(outer->data);
+        TAllocator::destroy(outer);
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Node* BTree<TData, TDataSize, TFanout, TAllocator>::clone(const Node* node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    if (!node->inner) {
+        const Outer* outer = static_cast<const Outer*>(node);
+        return createOuter(outer->size, outer->data);
+    }
+
+    const Inner* inner = static_cast<const Inner*>(node);
+    Inner* copy = createInner();
+
+    for (size_t i = 0; i < inner->count; i++) {
+        copy->children[i] = clone(inner->children[i]);
+    }
+
+    copy->count = inner->count;
+    update(copy);
+
+    return copy;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::update(Inner* inner) {
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < inner->count; i++) {
+        total += inner->children[i]->size;
+        inner->sizes[i] = total;
+    }
+
+    std::fill(inner->sizes + inner->count, inner->sizes + TFanout, Padding);
+
+    inner->size = total;
+    inner->height = inner->children[0]->height + 1;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+size_t BTree<TData, TDataSize, TFanout, TAllocator>::select(const Inner* inner, size_t index) {
+    // the child holding the index follows every child ending at or before it
+    return Search::rank(inner->sizes, inner->sizes + TFanout, index);
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+size_t BTree<TData, TDataSize, TFanout, TAllocator>::offset(const Inner* inner, size_t child) {
+    return child == 0 ? 0 : inner->sizes[child - 1];
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+TData& BTree<TData, TDataSize, TFanout, TAllocator>::at(Node* node, size_t index) {
+    while (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+        size_t child = select(inner, index);
+
+        index -= offset(inner, child);
+        node = inner->children[child];
+    }
+
+    return static_cast<Outer*>(node)->data[index];
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+void BTree<TData, TDataSize, TFanout, TAllocator>::array(const Node* node, TData* array) {
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+
+        for (size_t i = 0; i < inner->count; i++) {
+            BTree::array(inner->children[i], array + offset(inner, i));
+        }
+    } else {
+        const Outer* outer = static_cast<const Outer*>(node);
+        std::copy(outer->data, outer->data + outer->size, array);
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+template <typename TFunction>
+bool BTree<TData, TDataSize, TFanout, TAllocator>::forEachChunk(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function) {
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+
+        for (size_t i = begin > offset ? select(inner, begin - offset) : 0; i < inner->count; i++) {
+            size_t first = offset + BTree::offset(inner, i);
+
+            if (first >= end) {
+                break;
+            }
+
+            if (!forEachChunk(inner->children[i], first, begin, end, function)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+    size_t first = std::max(begin, offset);
+    size_t last = std::min(end, offset + outer->size);
+    std::span<const TData> chunk(outer->data + first - offset, last - first);
+
+    if constexpr (std::is_same_v<std::invoke_result_t<TFunction&, std::span<const TData>>, bool>) {
+        return function(chunk);
+    } else {
+        function(chunk);
+        return true;
+    }
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Inner* BTree<TData, TDataSize, TFanout, TAllocator>::insertChild(Inner* inner, size_t position, Node* child) {
+    Inner* sibling = nullptr;
+    Inner* target = inner;
+
+    if (inner->count == TFanout) {
+        // move the upper half into a new sibling
+        sibling = createInner();
+        sibling->count = TFanout - MinFanout;
+        inner->count = MinFanout;
+
+        std::copy(inner->children + MinFanout, inner->children + TFanout, sibling->children);
+
+        if (position > MinFanout) {
+            target = sibling;
+            position -= MinFanout;
+        }
+    }
+
+    std::copy_backward(target->children + position, target->children + target->count, target->children + target->count + 1);
+    target->children[position] = child;
+    target->count += 1;
+
+    update(inner);
+
+    if (sibling != nullptr) {
+        update(sibling);
+    }
+
+    return sibling;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+std::pair<typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*, typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*> BTree<TData, TDataSize, TFanout, TAllocator>::merge(Node* left, Node* right) {
+    if (!left->inner) {
+        Outer* first = static_cast<Outer*>(left);
+        Outer* second = static_cast<Outer*>(right);
+        size_t total = first->size + second->size;
+
+        if (total <= MaxSize) {
+            std::copy(second->data, second->data + second->size, first->data + first->size);
+            first->size = total;
+            destroy(second);
+
+            return {first, nullptr};
+        }
+
+        if (first->size < MinSize) {
+            size_t delta = total / 2 - first->size;
+
+            std::copy(second->data, second->data + delta, first->data + first->size);
+            std::copy(second->data + delta, second->data + second->size, second->data);
+
+            first->size += delta;
+            second->size -= delta;
+        } else if (second->size < MinSize) {
+            size_t delta = total / 2 - second->size;
+
+            std::copy_backward(second->data, second->data + second->size, second->data + second->size + delta);
+            std::copy(first->data + first->size - delta, first->data + first->size, second->data);
+
+            first->size -= delta;
+            second->size += delta;
+        }
+
+        return {first, second};
+    }
+
+    Inner* first = static_cast<Inner*>(left);
+    Inner* second = static_cast<Inner*>(right);
+    size_t total = first->count + second->count;
+
+    if (total <= TFanout) {
+        std::copy(second->children, second->children + second->count, first->children + first->count);
+        first->count = total;
+        update(first);
+
+        second->count = 0;
+        destroy(second);
+
+        return {first, nullptr};
+    }
+
+    if (first->count < MinFanout) {
+        size_t delta = total / 2 - first->count;
+
+        std::copy(second->children, second->children + delta, first->children + first->count);
+        std::copy(second->children + delta, second->children + second->count, second->children);
+
+        first->count += delta;
+        second->count -= delta;
+    } else if (second->count < MinFanout) {
+        size_t delta = total / 2 - second->count;
+
+        std::copy_backward(second->children, second->children + second->count, second->children + second->count + delta);
+        std::copy(first->children + first->count - delta, first->children + first->count, second->children);
+
+        first->count -= delta;
+        second->count += delta;
+    }
+
+    update(first);
+    update(second);
+
+    return {first, second};
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+std::pair<typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*, typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*> BTree<TData, TDataSize, TFanout, TAllocator>::joinNodes(Node* left, Node* right) {
+    if (left->height == right->height) {
+        return merge(left, right);
+    }
+
+    if (left->height > right->height) {
+        // join the right tree into the rightmost spine of the left tree
+        Inner* inner = static_cast<Inner*>(left);
+        auto [first, second] = joinNodes(inner->children[inner->count - 1], right);
+
+        inner->children[inner->count - 1] = first;
+
+        if (second == nullptr) {
+            update(inner);
+            return {inner, nullptr};
+        }
+
+        Inner* sibling = insertChild(inner, inner->count, second);
+        return {inner, sibling};
+    }
+
+    // join the left tree into the leftmost spine of the right tree
+    Inner* inner = static_cast<Inner*>(right);
+    auto [first, second] = joinNodes(left, inner->children[0]);
+
+    inner->children[0] = first;
+
+    if (second == nullptr) {
+        update(inner);
+        return {inner, nullptr};
+    }
+
+    Inner* sibling = insertChild(inner, 1, second);
+    return {inner, sibling};
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Node* BTree<TData, TDataSize, TFanout, TAllocator>::join(Node* left, Node* right) {
+    if (left == nullptr) {
+        return right;
+    }
+
+    if (right == nullptr) {
+        return left;
+    }
+
+    auto [first, second] = joinNodes(left, right);
+
+    if (second == nullptr) {
+        return first;
+    }
+
+    Inner* inner = createInner();
+
+    inner->children[0] = first;
+    inner->children[1] = second;
+    inner->count = 2;
+    update(inner);
+
+    return inner;
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+std::pair<typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*, typename BTree<TData, TDataSize, TFanout, TAllocator>::Node*> BTree<TData, TDataSize, TFanout, TAllocator>::split(Node* node, size_t index) {
+    if (node == nullptr || index == 0) {
+        return {nullptr, node};
+    }
+
+    if (index >= node->size) {
+        return {node, nullptr};
+    }
+
+    if (!node->inner) {
+        Outer* outer = static_cast<Outer*>(node);
+        Outer* right = createOuter(outer->size - index, outer->data + index);
+
+        outer->size = index;
+        return {outer, right};
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    size_t child = select(inner, index);
+    auto [first, second] = split(inner->children[child], index - offset(inner, child));
+
+    // the children before and after the split child, a single child is used directly
+    Node* before = child == 1 ? inner->children[0] : nullptr;
+    Node* after = child + 2 == inner->count ? inner->children[child + 1] : nullptr;
+
+    if (child + 2 < inner->count) {
+        Inner* rest = createInner();
+
+        std::copy(inner->children + child + 1, inner->children + inner->count, rest->children);
+        rest->count = inner->count - child - 1;
+        update(rest);
+
+        after = rest;
+    }
+
+    if (child > 1) {
+        inner->count = child;
+        update(inner);
+
+        before = inner;
+    } else {
+        inner->count = 0;
+        destroy(inner);
+    }
+
+    return {join(before, first), join(second, after)};
+}
+
+template <typename TData, size_t TDataSize, size_t TFanout, typename TAllocator>
+BTree<TData, TDataSize, TFanout, TAllocator>::Node* BTree<TData, TDataSize, TFanout, TAllocator>::group(std::span<Node*> nodes) {
+    Inner* inner = createInner();
+
+    std::copy(nodes.begin(), nodes.end(), inner->children);
+    inner->count = nodes.size();
+    update(inner);
+
+    return inner;
+}
+
+} // namespace Rope
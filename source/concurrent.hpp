@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// The rope namespace
+namespace Rope {
+
+/// The epoch based reclamation shared by all concurrent ropes
+/// A reader pins the current epoch while it accesses a published object,
+/// a retired object is reclaimed once every pinned epoch is past the epoch it was retired in
+class Epoch {
+    /// The epoch of a thread that is not pinned
+    static constexpr uint64_t Idle = std::numeric_limits<uint64_t>::max();
+
+    /// The record of a thread, records are reused but never freed
+    struct Record {
+        /// The pinned epoch, Idle if not pinned
+        std::atomic<uint64_t> epoch = Idle;
+        /// True while a thread owns the record
+        std::atomic<bool> used = true;
+        /// The next record
+        Record* next = nullptr;
+    };
+
+    /// Releases the record of the current thread when the thread exits
+    struct Owner {
+        /// The record of the thread
+        Record* record = nullptr;
+
+        ~Owner();
+    };
+
+    /// The records of all threads
+    static inline std::atomic<Record*> records = nullptr;
+    /// The global epoch
+    static inline std::atomic<uint64_t> global = 0;
+
+public:
+    /// Keeps the epoch of the current thread pinned until destroyed
+    /// Guards must not be nested
+    class Guard {
+        /// The record of the current thread
+        Record* record;
+
+    public:
+        /// Pins the current epoch
+        Guard();
+
+        /// Unpins the epoch
+        ~Guard();
+
+        Guard(const Guard& other) = delete;
+
+        Guard& operator=(const Guard& other) = delete;
+    };
+
+    /// Advances the global epoch and returns the epoch the retired objects belong to
+    static uint64_t advance();
+
+    /// Returns the oldest pinned epoch, objects retired before it can no longer be accessed
+    static uint64_t oldest();
+
+private:
+    static Record* record();
+};
+
+/// The rope shared between a single writer and any number of readers
+/// The writer edits a private version and publishes it with an atomic swap,
+/// readers take snapshots of the latest published version without locking
+/// A snapshot is a copy of the rope sharing its nodes, which is O(1) for Rope::Rope and Util::Rope
+/// and stays valid and consistent while the writer goes on, as shared nodes are never modified
+/// Replaced versions are reclaimed once no reader can still be copying them, see Epoch
+template <typename TRope>
+class Concurrent {
+    /// The latest published version
+    std::atomic<const TRope*> current;
+    /// The version edited by the writer
+    TRope working;
+    /// The replaced versions and the epochs they were retired in
+    std::vector<std::pair<const TRope*, uint64_t>> retired;
+
+public:
+    /// Constructs a concurrent rope publishing the provided rope
+    explicit Concurrent(TRope rope);
+
+    /// Destroys every version
+    /// No reader may take a snapshot concurrently, existing snapshots stay valid
+    ~Concurrent();
+
+    Concurrent(const Concurrent& other) = delete;
+
+    Concurrent& operator=(const Concurrent& other) = delete;
+
+    /// Returns a snapshot of the latest published version, safe to call from any thread
+    /// It never blocks and never waits for the writer
+    TRope snapshot() const;
+
+    /// Calls the function with the version of the writer and publishes the result
+    /// Only a single thread may write at a time
+    template <typename TFunction>
+    void update(TFunction&& function);
+
+    /// Replaces the version of the writer by the provided rope and publishes it
+    /// Only a single thread may write at a time
+    void publish(const TRope& rope);
+
+    /// Returns the version of the writer, edits to it are published by the next update or publish
+    TRope& writer();
+
+    /// Reclaims the replaced versions no reader can still access, called by every publish
+    void reclaim();
+
+    /// Returns the number of replaced versions not yet reclaimed
+    size_t pending() const;
+};
+
+inline Epoch::Owner::~Owner() {
+    if (record != nullptr) {
+        record->epoch.store(Idle, std::memory_order_release);
+        record->used.store(false, std::memory_order_release);
+    }
+}
+
+inline Epoch::Guard::Guard()
+    : record(Epoch::record())
+{
+    // the sequentially consistent store orders the pin before loading the published object
+    record->epoch.store(global.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+inline Epoch::Guard::~Guard() {
+    record->epoch.store(Idle, std::memory_order_release);
+}
+
+inline uint64_t Epoch::advance() {
+    return global.fetch_add(1, std::memory_order_seq_cst);
+}
+
+inline uint64_t Epoch::oldest() {
+    uint64_t oldest = Idle;
+
+    for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+        oldest = std::min(oldest, record->epoch.load(std::memory_order_seq_cst));
+    }
+
+    return oldest;
+}
+
+inline Epoch::Record* Epoch::record() {
+    thread_local Owner owner;
+
+    if (owner.record != nullptr) {
+        return owner.record;
+    }
+
+    // reuse the record of an exited thread
+    for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+        bool used = false;
+
+        if (!record->used.load(std::memory_order_relaxed) && record->used.compare_exchange_strong(used, true, std::memory_order_acquire)) {
+            return owner.record = record;
+        }
+    }
+
+    Record* record = new Record();
+    Record* head = records.load(std::memory_order_relaxed);
+
+    do {
+        record->next = head;
+    } while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+
+    return owner.record = record;
+}
+
+template <typename TRope>
+Concurrent<TRope>::Concurrent(TRope rope)
+    : current(new TRope(rope)), working(std::move(rope)) {}
+
+template <typename TRope>
+Concurrent<TRope>::~Concurrent() {
+    delete current.load(std::memory_order_relaxed);
+
+    for (auto& [version, epoch] : retired) {
+        delete version;
+    }
+}
+
+template <typename TRope>
+TRope Concurrent<TRope>::snapshot() const {
+    Epoch::Guard guard;
+    return TRope(*current.load(std::memory_order_seq_cst));
+}
+
+template <typename TRope>
+template <typename TFunction>
+void Concurrent<TRope>::update(TFunction&& function) {
+    function(working);
+    publish(working);
+}
+
+template <typename TRope>
+void Concurrent<TRope>::publish(const TRope& rope) {
+    if (&rope != &working) {
+        working = rope;
+    }
+
+    // the published version shares the nodes of the writer, which copies them before its next edit
+    const TRope* previous = current.exchange(new TRope(working), std::memory_order_seq_cst);
+
+    retired.emplace_back(previous, Epoch::advance());
+    reclaim();
+}
+
+template <typename TRope>
+TRope& Concurrent<TRope>::writer() {
+    return working;
+}
+
+template <typename TRope>
+void Concurrent<TRope>::reclaim() {
+    uint64_t oldest = Epoch::oldest();
+
+    auto end = std::remove_if(retired.begin(), retired.end(), [oldest](const std::pair<const TRope*, uint64_t>& entry) {
+        if (entry.second >= oldest) {
+            return false;
+        }
+
+        delete entry.first;
+        return true;
+    });
+
+    retired.erase(end, retired.end());
+}
+
+template <typename TRope>
+size_t Concurrent<TRope>::pending() const {
+    return retired.size();
+}
+
+} // namespace Rope
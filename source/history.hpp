@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+/// The rope namespace
+namespace Rope {
+
+/// The undo and redo history of a rope
+/// Every version is a copy of the rope sharing the unchanged nodes with its neighbours,
+/// so a version only costs the nodes its edit copied, O(log n) for a small edit
+/// The oldest versions are dropped once the history exceeds its memory or step limit
+/// Works with any rope providing O(1) copies and exclusive(), such as Rope::Rope and Util::Rope
+template <typename TRope>
+class History {
+    /// A version of the rope
+    struct Version {
+        /// The rope
+        TRope rope;
+        /// The bytes of the nodes this version added to the history
+        size_t cost;
+    };
+
+    /// The versions from the oldest to the newest
+    std::deque<Version> versions;
+    /// The index of the current version
+    size_t index;
+    /// The bytes of the nodes held by the history
+    size_t used;
+    /// The maximum number of bytes to keep
+    size_t limit;
+    /// The maximum number of versions to undo
+    size_t steps;
+
+public:
+    /// The value of an unlimited limit
+    static constexpr size_t Unlimited = size_t(-1);
+
+    /// Constructs a history starting with the provided rope
+    /// Older versions are dropped while the history uses more than limit bytes
+    /// or more than steps versions can be undone, the current version is always kept
+    explicit History(TRope rope, size_t limit = Unlimited, size_t steps = Unlimited);
+
+    /// Returns the current version
+    const TRope& current() const;
+
+    /// Calls the function with a copy of the current version and records the result
+    template <typename TFunction>
+    void edit(TFunction&& function);
+
+    /// Records the provided rope as the new current version and drops the versions to redo
+    /// The rope should be derived from the current version to share its nodes
+    void record(TRope rope);
+
+    /// Returns to the previous version, false if there is none
+    bool undo();
+
+    /// Returns to the next version, false if there is none
+    bool redo();
+
+    /// Returns the number of versions that can be undone
+    size_t undoCount() const;
+
+    /// Returns the number of versions that can be redone
+    size_t redoCount() const;
+
+    /// Returns the number of bytes of the nodes held by the history
+    size_t memory() const;
+
+    /// Drops the oldest versions until the history is within its limits
+    void compact();
+
+private:
+    void dropOldest();
+};
+
+template <typename TRope>
+History<TRope>::History(TRope rope, size_t limit, size_t steps)
+    : index(0), used(0), limit(limit), steps(steps)
+{
+    versions.push_back({std::move(rope), 0});
+    used = versions.back().cost = versions.back().rope.exclusive();
+}
+
+template <typename TRope>
+const TRope& History<TRope>::current() const {
+    return versions[index].rope;
+}
+
+template <typename TRope>
+template <typename TFunction>
+void History<TRope>::edit(TFunction&& function) {
+    TRope rope = current();
+
+    function(rope);
+    record(std::move(rope));
+}
+
+template <typename TRope>
+void History<TRope>::record(TRope rope) {
+    while (versions.size() > index + 1) {
+        used -= versions.back().cost;
+        versions.pop_back();
+    }
+
+    // the nodes copied by the edit are the only ones not shared with the previous version
+    versions.push_back({std::move(rope), 0});
+    versions.back().cost = versions.back().rope.exclusive();
+
+    used += versions.back().cost;
+    index++;
+
+    compact();
+}
+
+template <typename TRope>
+bool History<TRope>::undo() {
+    if (index == 0) {
+        return false;
+    }
+
+    index--;
+    return true;
+}
+
+template <typename TRope>
+bool History<TRope>::redo() {
+    if (index + 1 >= versions.size()) {
+        return false;
+    }
+
+    index++;
+    return true;
+}
+
+template <typename TRope>
+size_t History<TRope>::undoCount() const {
+    return index;
+}
+
+template <typename TRope>
+size_t History<TRope>::redoCount() const {
+    return versions.size() - index - 1;
+}
+
+template <typename TRope>
+size_t History<TRope>::memory() const {
+    return used;
+}
+
+template <typename TRope>
+void History<TRope>::compact() {
+    while (index > 0 && (used > limit || index > steps)) {
+        dropOldest();
+    }
+}
+
+template <typename TRope>
+void History<TRope>::dropOldest() {
+    Version& oldest = versions.front();
+
+    // the nodes the oldest version shares with the next one stay and are accounted to it
+    size_t freed = std::min(oldest.rope.exclusive(), oldest.cost);
+    size_t kept = oldest.cost - freed;
+
+    versions.pop_front();
+    versions.front().cost += kept;
+
+    used -= freed;
+    index--;
+}
+
+} // namespace Rope
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// The rope namespace
+namespace Rope {
+
+/// The fork-join pool of worker threads used by the parallel rope operations
+/// Every worker keeps a deque of forked tasks, it runs its newest task first
+/// and steals the oldest task of another worker once it has none left
+/// Any type with an invoke(left, right) member can be used as an executor instead
+class ThreadPool {
+    /// The forked task, it lives on the stack of the forking thread
+    struct Task {
+        /// Runs the function
+        void (*run)(void* function);
+        /// The function
+        void* function;
+        /// True once the function returned
+        std::atomic<bool> done = false;
+    };
+
+    /// The deque of forked tasks
+    struct Queue {
+        /// The mutex guarding the tasks
+        std::mutex mutex;
+        /// The tasks, the newest at the back
+        std::deque<Task*> tasks;
+    };
+
+    /// The pool and queue of the current thread
+    struct Current {
+        /// The pool of the current worker, null for other threads
+        ThreadPool* pool = nullptr;
+        /// The queue of the current worker
+        size_t index = 0;
+    };
+
+    /// The number of worker threads, fixed before any of them starts
+    const size_t threads;
+    /// The worker threads
+    std::vector<std::thread> workers;
+    /// The queues of the workers followed by the queue shared by all other threads
+    std::unique_ptr<Queue[]> queues;
+    /// The number of queued tasks
+    std::atomic<size_t> pending;
+
+    /// The mutex guarding the sleeping workers
+    std::mutex mutex;
+    /// The condition waking the sleeping workers
+    std::condition_variable condition;
+    /// True once the pool is destroyed
+    bool stopping;
+
+public:
+    /// Constructs a pool with the provided number of worker threads
+    /// The thread calling invoke works as well, so zero workers run everything inline
+    explicit ThreadPool(size_t threads);
+
+    /// Stops and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    /// Returns the number of worker threads
+    size_t size() const;
+
+    /// Runs both functions, possibly in parallel, and returns once both returned
+    /// The functions must not throw
+    template <typename TLeft, typename TRight>
+    void invoke(TLeft&& left, TRight&& right);
+
+    /// Returns the pool shared by all ropes with a worker for every further hardware thread
+    static ThreadPool& shared();
+
+private:
+    static Current& current();
+
+    size_t queue();
+
+    void push(size_t index, Task* task);
+
+    bool take(size_t index, Task* task);
+
+    Task* next(size_t index);
+
+    void work(size_t index);
+
+    static void execute(Task* task);
+};
+
+inline ThreadPool::ThreadPool(size_t threads)
+    : threads(threads), queues(new Queue[threads + 1]), pending(0), stopping(false)
+{
+    // the started workers only read the thread count, never the vector still being filled
+    workers.reserve(threads);
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this, i] {
+            work(i);
+        });
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    condition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+inline size_t ThreadPool::size() const {
+    return threads;
+}
+
+template <typename TLeft, typename TRight>
+void ThreadPool::invoke(TLeft&& left, TRight&& right) {
+    if (threads == 0) {
+        left();
+        right();
+
+        return;
+    }
+
+    Task task;
+
+    task.run = [](void* function) {
+        (*static_cast<std::remove_reference_t<TRight>*>(function))();
+    };
+    task.function = const_cast<void*>(static_cast<const void*>(std::addressof(right)));
+
+    size_t index = queue();
+
+    push(index, &task);
+    left();
+
+    if (take(index, &task)) {
+        right();
+        return;
+    }
+
+    // the task was stolen, help the others until it is done
+    while (!task.done.load(std::memory_order_acquire)) {
+        if (Task* other = next(index)) {
+            execute(other);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline ThreadPool& ThreadPool::shared() {
+    // the workers live until the process exits
+    static ThreadPool* pool = new ThreadPool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return *pool;
+}
+
+inline ThreadPool::Current& ThreadPool::current() {
+    thread_local Current current;
+    return current;
+}
+
+inline size_t ThreadPool::queue() {
+    Current& current = ThreadPool::current();
+    return current.pool == this ? current.index : threads;
+}
+
+inline void ThreadPool::push(size_t index, Task* task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[index].mutex);
+        queues[index].tasks.push_back(task);
+    }
+
+    pending.fetch_add(1, std::memory_order_release);
+
+    // taking the mutex orders the push before a worker going to sleep
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    condition.notify_one();
+}
+
+inline bool ThreadPool::take(size_t index, Task* task) {
+    Queue& queue = queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    // the shared queue may hold newer tasks of other threads
+    for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); it++) {
+        if (*it == task) {
+            queue.tasks.erase(std::next(it).base());
+            pending.fetch_sub(1, std::memory_order_relaxed);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline ThreadPool::Task* ThreadPool::next(size_t index) {
+    size_t count = threads + 1;
+
+    // the own newest task first, then the oldest task of the other queues
+    {
+        Queue& queue = queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            Task* task = queue.tasks.back();
+
+            queue.tasks.pop_back();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+
+            return task;
+        }
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        Queue& queue = queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            Task* task = queue.tasks.front();
+
+            queue.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+inline void ThreadPool::work(size_t index) {
+    current() = {this, index};
+
+    while (true) {
+        if (Task* task = next(index)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        condition.wait(lock, [this] {
+            return stopping || pending.load(std::memory_order_acquire) > 0;
+        });
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+inline void ThreadPool::execute(Task* task) {
+    task->run(task->function);
+    task->done.store(true, std::memory_order_release);
+}
+
+} // namespace Rope
@@ -1,8 +1,6 @@
 #pragma once
 
 #include <iostream>
-#include <memory>
-#include <stack>
 #include <utility>
 #include "tree.hpp"
 
@@ -10,553 +8,538 @@
 namespace Util {
 
 /// The rope data structure
-template <typename TData>
+/// The data is kept in a balanced tree of fixed size leaves, see Rope::Rope
+template <typename TData, typename TSummary = ::Rope::Summary::None, typename TAllocator = ::Rope::PoolAllocator<>>
 class Rope {
-    /// The base struct for inner and outer nodes
-    struct Node {
-        /// True if it is an inner node
-        bool inner;
-        /// The size of the node
-        size_t size;
-    };
-
-    /// The inner node
-    struct Inner : public Node {
-        /// The left child of the inner node
-        Node* left;
-        /// The right child of the inner node
-        Node* right;
-    };
-
-    /// The outer node
-    struct Outer : public Node {
-        /// The data of the node
-        TData* data;
-    };
-
-    /// The iterator for the rope
-    template <typename TOther>
-    class Iterator {
-        /// The stack of nodes
-        std::stack<Node*> nodes;
-
-        /// The index of the current data
-        size_t index;
-
-    public:
-        /// Constructs an end iterator
-        Iterator();
-
-        /// Constructs an iterator with the provided root
-        Iterator(Node* root);
-
-        /// Returns a ref to the current data
-        TOther& operator*() const;
-
-        /// Returns a pointer to the current data
-        TOther* operator->() const;
-
-        /// Increments this iterator
-        Iterator<TOther>& operator++();
-
-        /// Returns true if the two iterators are the same
-        bool operator!=(const Iterator<TOther>& other) const;
-    };
-
-    typedef Iterator<TData> Iter;
-    typedef Iterator<const TData> ConstIter;
+    /// The underlying tree
+    typedef ::Rope::Rope<TData, 1024, TSummary, TAllocator> Tree;
 
-private:
-    /// The root node
-    Node* root;
+public:
+    typedef typename Tree::Iter Iter;
+    typedef typename Tree::ConstIter ConstIter;
+    typedef typename Tree::Reference Reference;
+    typedef typename Tree::Cursor Cursor;
+    typedef typename Tree::Edit Edit;
+    typedef typename TSummary::Value Value;
 
-    /// Constructs a rope with the provided root
-    Rope(Node* root);
+    /// The index returned if nothing was found
+    static constexpr size_t NotFound = Tree::NotFound;
+
+private:
+    /// The tree holding the data
+    Tree tree;
 
-    /// Constructs a rope with the provided data
-    Rope(size_t size, TData* data);
+    /// Constructs a rope with the provided tree
+    Rope(Tree&& tree);
 
 public:
     /// Constructs an empty rope
-    static Rope<TData> empty();
+    static Rope<TData, TSummary, TAllocator> empty();
+
+    /// Constructs a balanced rope by copying the provided data
+    /// Subtrees are built on up to the provided number of threads
+    static Rope<TData, TSummary, TAllocator> copy(size_t size, TData* data, size_t threads = 1);
+
+    /// Constructs a balanced rope by moving the provided data without copying it
+    /// The data must be allocated with new[] and is released by the rope, see Rope::Rope::adopt
+    static Rope<TData, TSummary, TAllocator> move(size_t size, TData* data, size_t threads = 1);
+
+    /// Constructs a rope referencing the contents of the provided file without copying them
+    /// Throws a std::system_error if the file cannot be mapped
+    static Rope<TData, TSummary, TAllocator> map(const char* path);
 
-    /// Constructs a rope by copying the provided data
-    static Rope<TData> copy(size_t size, TData* data);
+    /// Constructs a rope by reading the provided file descriptor until its end
+    /// Throws a std::system_error if a read fails
+    static Rope<TData, TSummary, TAllocator> read(int fd);
 
-    /// Constructs a rope by moving the provided data
-    /// The data must be heap allocated
-    static Rope<TData> move(size_t size, TData* data);
+    /// Constructs a rope by reading the provided stream until its end
+    static Rope<TData, TSummary, TAllocator> read(std::istream& is);
 
     /// The destructor
-    ~Rope();
+    ~Rope() = default;
 
     /// The copy constructor
-    Rope(const Rope<TData>& other);
+    Rope(const Rope<TData, TSummary, TAllocator>& other) = default;
 
     /// The move constructor
-    Rope(Rope<TData>&& other);
+    Rope(Rope<TData, TSummary, TAllocator>&& other) = default;
 
     /// The copy assignment operator
-    Rope<TData>& operator=(const Rope<TData>& other);
+    Rope<TData, TSummary, TAllocator>& operator=(const Rope<TData, TSummary, TAllocator>& other) = default;
 
     /// The move assignment operator
-    Rope<TData>& operator=(Rope<TData>&& other);
+    Rope<TData, TSummary, TAllocator>& operator=(Rope<TData, TSummary, TAllocator>&& other) = default;
 
     /// The index operator
-    TData& operator[](size_t index) const;
+    Reference operator[](size_t index);
+
+    /// The const index operator
+    const TData& operator[](size_t index) const;
 
     /// Appends the provided rope
     /// The provided rope is cleared durring the process
-    void append(Rope<TData>&& other);
+    void append(Rope<TData, TSummary, TAllocator>&& other);
 
     /// Inserts the provided rope at the provided index
     /// The provided rope is cleared durring the process
-    void insert(size_t index, Rope<TData>&& other);
+    void insert(size_t index, Rope<TData, TSummary, TAllocator>&& other);
 
     /// Erases the data between the provided begin and end indices
     void erase(size_t begin, size_t end);
 
+    /// Applies the provided edits, sorted by index and not overlapping, in a single pass
+    void apply(std::span<const Edit> edits);
+
     /// Clears the rope
     void clear();
 
     /// Splits the rope at the provided index
     /// This rope is cleared durring the process
-    std::pair<Rope<TData>, Rope<TData>> split(size_t index);
+    std::pair<Rope<TData, TSummary, TAllocator>, Rope<TData, TSummary, TAllocator>> split(size_t index);
+
+    /// Replaces the data at the specified index and updates the summaries
+    void set(size_t index, const TData& value);
+
+    /// Returns the summary of the entire rope
+    const Value& summary() const;
+
+    /// Returns the summary of the data between the provided indices
+    Value summarize(size_t begin, size_t end) const;
+
+    /// Returns the first index whose summary up to and including it satisfies the predicate
+    template <typename TPredicate>
+    size_t seek(TPredicate&& predicate) const;
+
+    /// Returns the number of lines, one more than the number of line breaks
+    size_t lineCount() const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary>;
+
+    /// Returns the index of the first data of the provided line, or the size if there is no such line
+    size_t lineStart(size_t line) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary>;
+
+    /// Returns the line of the provided index
+    size_t lineOf(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary>;
+
+    /// Returns the line and column of the provided index
+    std::pair<size_t, size_t> lineColumn(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary>;
+
+    /// Returns the index of the provided line and column
+    size_t indexOf(size_t line, size_t column) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary>;
+
+    /// Returns the number of UTF-8 codepoints
+    size_t codepointCount() const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary>;
+
+    /// Returns the number of codepoints starting before the provided index
+    size_t codepointOf(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary>;
+
+    /// Returns the index of the provided codepoint, or the size if there is no such codepoint
+    size_t indexOfCodepoint(size_t codepoint) const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary>;
+
+    /// Returns the number of UTF-16 code units
+    size_t utf16Count() const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary>;
+
+    /// Returns the number of UTF-16 code units of the codepoints starting before the provided index
+    size_t utf16Of(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary>;
+
+    /// Returns the index of the codepoint holding the provided UTF-16 code unit, or the size if there is none
+    size_t indexOfUtf16(size_t unit) const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary>;
+
+    /// Returns the polynomial hash of the data between the provided indices in O(log n)
+    uint64_t hash(size_t begin, size_t end) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary>;
+
+    /// Returns the first index at which both ropes differ, or the smaller size if one is a prefix of the other
+    size_t mismatch(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary>;
+
+    /// Compares both ropes lexicographically and returns a negative value, zero or a positive value
+    int compare(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary>;
+
+    /// True if both ropes hold the same data
+    bool operator==(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary>;
 
     /// Creates an array containing the entire data of the rope
     TData* array() const;
 
+    /// Writes the entire data to the provided file descriptor with vectored writes
+    /// Throws a std::system_error if a write fails
+    void writeTo(int fd) const;
+
     /// Returns the data at the specified index
-    TData& at(size_t index) const;
+    Reference at(size_t index);
+
+    /// Returns the const data at the specified index
+    const TData& at(size_t index) const;
 
     /// Returns the size of the rope
     size_t size() const;
 
-    /// Returns the begin iterator
-    Iter begin();
+    /// Returns the statistics of the structure of the rope in O(n)
+    ::Rope::Stats stats() const;
 
-    /// Returns the end iterator
-    Iter end();
+    /// Returns the number of bytes allocated for the nodes not shared with any other rope
+    size_t exclusive() const;
 
-    /// Returns the const begin iterator
-    ConstIter begin() const;
+    /// Calls the function with the data of every leaf between the provided indices
+    /// The function may return false to stop, in which case false is returned
+    template <typename TFunction>
+    bool forEachChunk(size_t begin, size_t end, TFunction&& function) const;
 
-    /// Returns the const end iterator
-    ConstIter end() const;
+    /// Calls the function with the data and the index of every leaf between the provided indices
+    /// Large subtrees are visited concurrently by the executor
+    template <typename TFunction, typename TExecutor = ::Rope::ThreadPool>
+    void parallelForEachChunk(size_t begin, size_t end, TFunction&& function, TExecutor& executor = ::Rope::ThreadPool::shared()) const;
 
-private:
-    static Node* createEmpty();
+    /// Maps the data of every leaf between the provided indices and combines the results in order
+    template <typename TValue, typename TMap, typename TCombine, typename TExecutor = ::Rope::ThreadPool>
+    TValue parallelReduce(size_t begin, size_t end, TValue identity, TMap&& map, TCombine&& combine, TExecutor& executor = ::Rope::ThreadPool::shared()) const;
 
-    static Inner* createInner(Node* left, Node* right);
+    /// Copies the data between the provided indices to the destination concurrently
+    template <typename TExecutor = ::Rope::ThreadPool>
+    void parallelCopy(size_t begin, size_t end, TData* destination, TExecutor& executor = ::Rope::ThreadPool::shared()) const;
 
-    static Outer* createOuter(size_t size, TData* data);
+    /// Creates an array containing the entire data of the rope, copied concurrently
+    template <typename TExecutor = ::Rope::ThreadPool>
+    TData* parallelArray(TExecutor& executor = ::Rope::ThreadPool::shared()) const;
 
-    static Node* copy(Node* node);
+    /// Returns the index of the first value at or after the provided index
+    size_t find(const TData& value, size_t index = 0) const;
 
-    static void clear(Node* node);
+    /// Returns the index of the first needle at or after the provided index
+    size_t find(std::span<const TData> needle, size_t index = 0) const;
 
-    static std::pair<Node*, Node*> split(Node* node, size_t index);
+    /// Returns the index of the last value at or before the provided index
+    size_t rfind(const TData& value, size_t index = NotFound) const;
 
-    static void array(Node* node, TData* begin);
+    /// Returns the index of the last needle at or before the provided index
+    size_t rfind(std::span<const TData> needle, size_t index = NotFound) const;
 
-    static TData& at(Node* node, size_t index);
+    /// Returns the number of values between the provided indices
+    size_t count(const TData& value, size_t begin = 0, size_t end = NotFound) const;
 
-    static size_t size(Node* node);
+    /// Returns a cursor at the provided index
+    /// Edits near the cursor avoid splitting the tree, see Rope::Rope::Cursor
+    Cursor cursor(size_t index = 0);
 
-    template <typename TOther>
-    friend std::ostream& operator<<(std::ostream& os, const Rope<TOther>& rope);
-};
+    /// Returns the const begin iterator
+    ConstIter begin() const;
 
-template <typename TData>
-Rope<TData>::Rope(Node* root) 
-    : root(root)
-{
-    // empty
-}
+    /// Returns the const end iterator
+    ConstIter end() const;
+
+    /// Returns the mutable begin iterator, which copies the shared leaves it enters
+    Iter mutableBegin();
+
+    /// Returns the mutable end iterator
+    Iter mutableEnd();
+};
 
-template <typename TData>
-Rope<TData>::Rope(size_t size, TData *data)
-    : root(createOuter(size, data))
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Rope(Tree&& tree)
+    : tree(std::move(tree))
 {
     // empty
 }
 
-template <typename TData>
-Rope<TData> Rope<TData>::empty() {
-    return Rope<TData>(0, nullptr);
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::empty() {
+    return Rope<TData, TSummary, TAllocator>(Tree());
 }
 
-template <typename TData>
-Rope<TData> Rope<TData>::copy(size_t size, TData* data) {
-    TData* copy = new TData[size];
-    std::copy(data, data + size, copy);
-
-    return move(size, copy);
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::copy(size_t size, TData* data, size_t threads) {
+    return Rope<TData, TSummary, TAllocator>(Tree(size, data, threads));
 }
 
-template <typename TData>
-Rope<TData> Rope<TData>::move(size_t size, TData* data) {
-    return Rope<TData>(size, data);
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::move(size_t size, TData* data, size_t threads) {
+    return Rope<TData, TSummary, TAllocator>(Tree::adopt(size, data, threads));
 }
 
-template <typename TData>
-Rope<TData>::~Rope() {
-    clear();
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::map(const char* path) {
+    return Rope<TData, TSummary, TAllocator>(Tree::map(path));
 }
 
-template <typename TData>
-Rope<TData>::Rope(const Rope<TData>& other) 
-    : root(copy(other.root))
-{
-    // empty
-}
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::read(int fd) {
+    typename Tree::Builder builder;
 
-template <typename TData>
-Rope<TData>::Rope(Rope<TData>&& other) 
-    : root(other.root)
-{
-    other.root = createEmpty();
+    builder.read(fd);
+    return Rope<TData, TSummary, TAllocator>(builder.build());
 }
 
-template <typename TData>
-Rope<TData>& Rope<TData>::operator=(const Rope<TData>& other) {
-    clear();
-    root = copy(other.root);
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator> Rope<TData, TSummary, TAllocator>::read(std::istream& is) {
+    typename Tree::Builder builder;
 
-    return *this;
+    builder.read(is);
+    return Rope<TData, TSummary, TAllocator>(builder.build());
 }
 
-template <typename TData>
-Rope<TData>& Rope<TData>::operator=(Rope<TData>&& other) {
-    clear();
-
-    root = other.root;
-    other.root = createEmpty();
-
-    return *this;
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Reference Rope<TData, TSummary, TAllocator>::operator[](size_t index) {
+    return at(index);
 }
 
-template <typename TData>
-TData& Rope<TData>::operator[](size_t index) const {
+template <typename TData, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TSummary, TAllocator>::operator[](size_t index) const {
     return at(index);
 }
 
-template <typename TData>
-void Rope<TData>::append(Rope<TData>&& other) {
-    if (other.size() > 0) {
-        root = size() > 0
-            ? createInner(root, other.root)
-            : other.root;
-        
-        other.root = createEmpty();
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::append(Rope<TData, TSummary, TAllocator>&& other) {
+    tree.append(std::move(other.tree));
 }
 
-template <typename TData>
-void Rope<TData>::insert(size_t index, Rope<TData>&& other) {
-    auto [left, right] = split(index);
-
-    left.append(other);
-    left.append(right);
-
-    std::swap(root, left.root);
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::insert(size_t index, Rope<TData, TSummary, TAllocator>&& other) {
+    tree.insert(std::move(other.tree), index);
 }
 
-template <typename TData>
-void Rope<TData>::erase(size_t begin, size_t end) {
-    Rope<TData> left;
-    Rope<TData> center;
-    Rope<TData> right;
-
-    std::tie(left, center) = split(begin);
-    std::tie(center, right) = center.split(end);
-    
-    left.append(right);
-    std::swap(root, left.root);
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::erase(size_t begin, size_t end) {
+    tree.remove(begin, end);
 }
 
-template <typename TData>
-void Rope<TData>::clear() {
-    clear(root);
-    root = createEmpty();
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::apply(std::span<const Edit> edits) {
+    tree.apply(edits);
 }
 
-template <typename TData>
-std::pair<Rope<TData>, Rope<TData>> Rope<TData>::split(size_t index) {
-    auto [left, right] = split(root, index);
-    root = createEmpty();
-
-    return std::make_pair(Rope<TData>(left), Rope<TData>(right));
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::clear() {
+    tree.clear();
 }
 
-template <typename TData>
-TData* Rope<TData>::array() const {
-    TData* data = new TData[size()];
-    array(root, data);
-
-    return data;
+template <typename TData, typename TSummary, typename TAllocator>
+std::pair<Rope<TData, TSummary, TAllocator>, Rope<TData, TSummary, TAllocator>> Rope<TData, TSummary, TAllocator>::split(size_t index) {
+    auto [left, right] = tree.split(index);
+    return std::make_pair(Rope<TData, TSummary, TAllocator>(std::move(left)), Rope<TData, TSummary, TAllocator>(std::move(right)));
 }
 
-template <typename TData>
-TData& Rope<TData>::at(size_t index) const {
-    return at(root, index);
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::set(size_t index, const TData& value) {
+    tree.set(index, value);
 }
 
-template <typename TData>
-size_t Rope<TData>::size() const {
-    return size(root);
+template <typename TData, typename TSummary, typename TAllocator>
+const Rope<TData, TSummary, TAllocator>::Value& Rope<TData, TSummary, TAllocator>::summary() const {
+    return tree.summary();
 }
 
-template <typename TData>
-Rope<TData>::Iter Rope<TData>::begin() {
-    return Iter(root);
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Value Rope<TData, TSummary, TAllocator>::summarize(size_t begin, size_t end) const {
+    return tree.summarize(begin, end);
 }
 
-template <typename TData>
-Rope<TData>::Iter Rope<TData>::end() {
-    return Iter();
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TPredicate>
+size_t Rope<TData, TSummary, TAllocator>::seek(TPredicate&& predicate) const {
+    return tree.seek(std::forward<TPredicate>(predicate));
 }
 
-template <typename TData>
-Rope<TData>::ConstIter Rope<TData>::begin() const {
-    return ConstIter(root);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::lineCount() const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary> {
+    return tree.lineCount();
 }
 
-template <typename TData>
-Rope<TData>::ConstIter Rope<TData>::end() const {
-    return ConstIter();
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::lineStart(size_t line) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary> {
+    return tree.lineStart(line);
 }
 
-template <typename TData>
-Rope<TData>::Node* Rope<TData>::createEmpty() {
-    return createOuter(0, nullptr);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::lineOf(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary> {
+    return tree.lineOf(index);
 }
 
-template <typename TData>
-Rope<TData>::Inner* Rope<TData>::createInner(Node* left, Node* right)
-{
-    Inner* inner = new Inner();
-
-    inner->inner = true;
-    inner->size = size(left);
-    inner->left = left;
-    inner->right = right;
-
-    return inner;
+template <typename TData, typename TSummary, typename TAllocator>
+std::pair<size_t, size_t> Rope<TData, TSummary, TAllocator>::lineColumn(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary> {
+    return tree.lineColumn(index);
 }
 
-template <typename TData>
-Rope<TData>::Outer* Rope<TData>::createOuter(size_t size, TData* data) {
-    Outer* outer = new Outer();
-
-    outer->inner = false;
-    outer->size = size;
-    outer->data = data;
-
-    return outer;
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::indexOf(size_t line, size_t column) const requires ::Rope::Summary::Contains<::Rope::Summary::Lines, TSummary> {
+    return tree.indexOf(line, column);
 }
 
-template <typename TData>
-Rope<TData>::Node *Rope<TData>::copy(Node *node)
-{
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        Node* left = copy(inner->left);
-        Node* right = copy(inner->right);
-
-        return createInner(left, inner);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        return createOuter(outer->size, outer->data);
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::codepointCount() const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary> {
+    return tree.codepointCount();
 }
 
-template <typename TData>
-void Rope<TData>::clear(Node* node) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-
-        clear(inner->left);
-        clear(inner->right);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        delete[] outer->data;
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::codepointOf(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary> {
+    return tree.codepointOf(index);
+}
 
-    delete node;
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::indexOfCodepoint(size_t codepoint) const requires ::Rope::Summary::Contains<::Rope::Summary::Codepoints, TSummary> {
+    return tree.indexOfCodepoint(codepoint);
 }
 
-template <typename TData>
-std::pair<typename Rope<TData>::Node*, typename Rope<TData>::Node*> Rope<TData>::split(Node* node, size_t index) {
-    Node* left;
-    Node* right;
-    
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::utf16Count() const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary> {
+    return tree.utf16Count();
+}
 
-        if (index < inner->size) {
-            std::tie(left, right) = split(inner->left, index);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::utf16Of(size_t index) const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary> {
+    return tree.utf16Of(index);
+}
 
-            inner->left = right;
-            right = inner;
-        } else if (index > inner->size) {
-            std::tie(left, right) = split(inner->right, inner->size - index);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::indexOfUtf16(size_t unit) const requires ::Rope::Summary::Contains<::Rope::Summary::Utf16, TSummary> {
+    return tree.indexOfUtf16(unit);
+}
 
-            inner->right = left;
-            left = inner;
-        } else {
-            left = inner->left;
-            right = inner->right;
+template <typename TData, typename TSummary, typename TAllocator>
+uint64_t Rope<TData, TSummary, TAllocator>::hash(size_t begin, size_t end) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary> {
+    return tree.hash(begin, end);
+}
 
-            delete inner;
-        }
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::mismatch(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary> {
+    return tree.mismatch(other.tree);
+}
 
-        size_t leftSize = index;
-        size_t rightSize = outer->size - index;
+template <typename TData, typename TSummary, typename TAllocator>
+int Rope<TData, TSummary, TAllocator>::compare(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary> {
+    return tree.compare(other.tree);
+}
 
-        TData* leftData = new TData[leftSize];
-        TData* rightData = new TData[rightSize];
+template <typename TData, typename TSummary, typename TAllocator>
+bool Rope<TData, TSummary, TAllocator>::operator==(const Rope& other) const requires ::Rope::Summary::Contains<::Rope::Summary::Hash, TSummary> {
+    return tree == other.tree;
+}
 
-        std::copy(outer->data, outer->data + leftSize, leftData);
-        std::copy(outer->data + leftSize, outer->data + outer->size, rightData);
+template <typename TData, typename TSummary, typename TAllocator>
+TData* Rope<TData, TSummary, TAllocator>::array() const {
+    return tree.array();
+}
 
-        left = createOuter(leftSize, leftData);
-        right = createOuter(rightSize, rightData);
+template <typename TData, typename TSummary, typename TAllocator>
+void Rope<TData, TSummary, TAllocator>::writeTo(int fd) const {
+    tree.writeTo(fd);
+}
 
-        delete[] outer->data;
-        delete outer;
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Reference Rope<TData, TSummary, TAllocator>::at(size_t index) {
+    return tree.at(index);
+}
 
-    return std::make_pair(left, right);
+template <typename TData, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TSummary, TAllocator>::at(size_t index) const {
+    return tree.at(index);
 }
 
-template <typename TData>
-void Rope<TData>::array(Node* node, TData* begin) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::size() const {
+    return tree.size();
+}
 
-        array(inner->left, begin);
-        array(inner->right, begin + inner->size);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        std::copy(outer->data, outer->data + outer->size, begin);
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+::Rope::Stats Rope<TData, TSummary, TAllocator>::stats() const {
+    return tree.stats();
 }
 
-template <typename TData>
-TData& Rope<TData>::at(Node* node, size_t index) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        
-        return index < inner->size
-            ? at(node->left, index)
-            : at(node->right, index - inner->size);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        return outer->data[index];
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::exclusive() const {
+    return tree.exclusive();
 }
 
-template <typename TData>
-size_t Rope<TData>::size(Node* node) {
-    size_t total = node->size;
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TFunction>
+bool Rope<TData, TSummary, TAllocator>::forEachChunk(size_t begin, size_t end, TFunction&& function) const {
+    return tree.forEachChunk(begin, end, std::forward<TFunction>(function));
+}
 
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        total += size(inner->right);
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TFunction, typename TExecutor>
+void Rope<TData, TSummary, TAllocator>::parallelForEachChunk(size_t begin, size_t end, TFunction&& function, TExecutor& executor) const {
+    tree.parallelForEachChunk(begin, end, std::forward<TFunction>(function), executor);
+}
 
-    return total;
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TValue, typename TMap, typename TCombine, typename TExecutor>
+TValue Rope<TData, TSummary, TAllocator>::parallelReduce(size_t begin, size_t end, TValue identity, TMap&& map, TCombine&& combine, TExecutor& executor) const {
+    return tree.parallelReduce(begin, end, identity, std::forward<TMap>(map), std::forward<TCombine>(combine), executor);
 }
 
-template <typename TOther>
-std::ostream& operator<<(std::ostream& os, const Rope<TOther>& rope) {
-    for (const TOther& data : rope) {
-        os << data;
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TExecutor>
+void Rope<TData, TSummary, TAllocator>::parallelCopy(size_t begin, size_t end, TData* destination, TExecutor& executor) const {
+    tree.parallelCopy(begin, end, destination, executor);
+}
 
-    return os;
+template <typename TData, typename TSummary, typename TAllocator>
+template <typename TExecutor>
+TData* Rope<TData, TSummary, TAllocator>::parallelArray(TExecutor& executor) const {
+    return tree.parallelArray(executor);
 }
 
-template <typename TData>
-template <typename TOther>
-Rope<TData>::Iterator<TOther>::Iterator() 
-    : nodes()
-    , index(0)
-{
-    // empty
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::find(const TData& value, size_t index) const {
+    return tree.find(value, index);
 }
 
-template <typename TData>
-template <typename TOther>
-Rope<TData>::Iterator<TOther>::Iterator(Node *root)
-    : nodes()
-    , index(0)
-{
-    if (size(root) > 0) {
-        do {
-            nodes.push(root);
-        } while (root->inner && (root = static_cast<Inner*>(root)->left));
-    }
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::find(std::span<const TData> needle, size_t index) const {
+    return tree.find(needle, index);
 }
 
-template <typename TData>
-template <typename TOther>
-TOther& Rope<TData>::Iterator<TOther>::operator*() const {
-    Outer* outer = static_cast<Outer*>(nodes.top());
-    return outer->data[index];
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::rfind(const TData& value, size_t index) const {
+    return tree.rfind(value, index);
 }
 
-template <typename TData>
-template <typename TOther>
-TOther* Rope<TData>::Iterator<TOther>::operator->() const {
-    return &(this->operator*());
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::rfind(std::span<const TData> needle, size_t index) const {
+    return tree.rfind(needle, index);
 }
 
-template <typename TData>
-template <typename TOther>
-Rope<TData>::Iterator<TOther>& Rope<TData>::Iterator<TOther>::operator++() {
-    Node* node = nodes.top();
-    index += 1;
+template <typename TData, typename TSummary, typename TAllocator>
+size_t Rope<TData, TSummary, TAllocator>::count(const TData& value, size_t begin, size_t end) const {
+    return tree.count(value, begin, end);
+}
 
-    if (index == node->size) {
-        Inner* inner;
-        index = 0;
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Cursor Rope<TData, TSummary, TAllocator>::cursor(size_t index) {
+    return tree.cursor(index);
+}
 
-        do {
-            nodes.pop();
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::ConstIter Rope<TData, TSummary, TAllocator>::begin() const {
+    return tree.begin();
+}
 
-            if (nodes.empty()) {
-                return *this;
-            }
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::ConstIter Rope<TData, TSummary, TAllocator>::end() const {
+    return tree.end();
+}
 
-            inner = static_cast<Inner*>(nodes.top());
-        } while (node == inner->right && (node = inner));
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Iter Rope<TData, TSummary, TAllocator>::mutableBegin() {
+    return tree.mutableBegin();
+}
 
-        node = inner->right;
+template <typename TData, typename TSummary, typename TAllocator>
+Rope<TData, TSummary, TAllocator>::Iter Rope<TData, TSummary, TAllocator>::mutableEnd() {
+    return tree.mutableEnd();
+}
 
-        while (node->inner) {
-            inner = static_cast<Inner*>(node);
-            node = inner->left;
+template <typename TData, typename TSummary, typename TAllocator>
+std::ostream& operator<<(std::ostream& os, const Rope<TData, TSummary, TAllocator>& rope) {
+    if constexpr (std::is_same_v<TData, std::ostream::char_type>) {
+        // characters are written a leaf at a time instead of formatted one by one
+        rope.forEachChunk(0, rope.size(), [&](std::span<const TData> chunk) {
+            return bool(os.write(chunk.data(), chunk.size()));
+        });
+    } else {
+        for (const TData& data : rope) {
+            os << data;
         }
     }
 
-    return *this;
-}
-
-template <typename TData>
-template <typename TOther>
-bool Rope<TData>::Iterator<TOther>::operator!=(const Iterator<TOther>& other) const {
-    Node* node = nodes.size() > 0
-        ? nodes.top()
-        : nullptr;
-    Node* otherNode = other.nodes.size() > 0
-        ? other.nodes.top()
-        : nullptr;
-
-    return node != otherNode || index != other.index;
+    return os;
 }
 
-} // namespace Util
\ No newline at end of file
+} // namespace Util
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROPE_SEARCH_X86
+#endif
+
+/// The rope namespace
+namespace Rope {
+
+/// The search kernels used by the rope
+/// Single byte types are scanned with SSE2 or AVX2, chosen at runtime
+namespace Search {
+
+/// Returns a pointer to the first data equal to value or end
+template <typename T>
+const T* find(const T* begin, const T* end, const T& value);
+
+/// Returns a pointer to the last data equal to value or end
+template <typename T>
+const T* rfind(const T* begin, const T* end, const T& value);
+
+/// Returns the number of data equal to value
+template <typename T>
+size_t count(const T* begin, const T* end, const T& value);
+
+/// Returns the number of values less than or equal to value
+/// The values must not exceed INT64_MAX
+size_t rank(const uint64_t* begin, const uint64_t* end, uint64_t value);
+
+/// Returns the number of bytes whose signed value is greater than value
+size_t countGreater(const uint8_t* begin, const uint8_t* end, int8_t value);
+
+/// True if the type is compared bytewise by the kernels
+template <typename T>
+constexpr bool Bytewise = sizeof(T) == 1 && (std::is_integral_v<T> || std::is_enum_v<T>);
+
+/// The byte kernels
+struct Kernels {
+    const uint8_t* (*find)(const uint8_t* begin, const uint8_t* end, uint8_t value);
+    const uint8_t* (*rfind)(const uint8_t* begin, const uint8_t* end, uint8_t value);
+    size_t (*count)(const uint8_t* begin, const uint8_t* end, uint8_t value);
+    size_t (*rank)(const uint64_t* begin, const uint64_t* end, uint64_t value);
+    size_t (*countGreater)(const uint8_t* begin, const uint8_t* end, int8_t value);
+};
+
+inline const uint8_t* findScalar(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    return std::find(begin, end, value);
+}
+
+inline const uint8_t* rfindScalar(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    for (const uint8_t* it = end; it != begin;) {
+        if (*--it == value) {
+            return it;
+        }
+    }
+
+    return end;
+}
+
+inline size_t countScalar(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    return std::count(begin, end, value);
+}
+
+inline size_t rankScalar(const uint64_t* begin, const uint64_t* end, uint64_t value) {
+    size_t total = 0;
+
+    for (const uint64_t* it = begin; it != end; it++) {
+        total += *it <= value;
+    }
+
+    return total;
+}
+
+inline size_t countGreaterScalar(const uint8_t* begin, const uint8_t* end, int8_t value) {
+    size_t total = 0;
+
+    for (const uint8_t* it = begin; it != end; it++) {
+        total += int8_t(*it) > value;
+    }
+
+    return total;
+}
+
+#ifdef ROPE_SEARCH_X86
+
+inline const uint8_t* findSse2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m128i needle = _mm_set1_epi8(char(value));
+    const uint8_t* it = begin;
+
+    for (; end - it >= 16; it += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+
+        if (mask != 0) {
+            return it + __builtin_ctz(mask);
+        }
+    }
+
+    return findScalar(it, end, value);
+}
+
+inline const uint8_t* rfindSse2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m128i needle = _mm_set1_epi8(char(value));
+    const uint8_t* it = end;
+
+    for (; it - begin >= 16; it -= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it - 16));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+
+        if (mask != 0) {
+            return it - 16 + (31 - __builtin_clz(mask));
+        }
+    }
+
+    const uint8_t* result = rfindScalar(begin, it, value);
+    return result == it ? end : result;
+}
+
+inline size_t countSse2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m128i needle = _mm_set1_epi8(char(value));
+    const uint8_t* it = begin;
+    size_t total = 0;
+
+    while (end - it >= 16) {
+        // the byte counters overflow after 255 blocks
+        size_t blocks = std::min<size_t>((end - it) / 16, 255);
+        __m128i counters = _mm_setzero_si128();
+
+        for (size_t i = 0; i < blocks; i++, it += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, needle));
+        }
+
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        total += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+
+    return total + countScalar(it, end, value);
+}
+
+inline size_t countGreaterSse2(const uint8_t* begin, const uint8_t* end, int8_t value) {
+    const __m128i bound = _mm_set1_epi8(value);
+    const uint8_t* it = begin;
+    size_t total = 0;
+
+    while (end - it >= 16) {
+        // the byte counters overflow after 255 blocks
+        size_t blocks = std::min<size_t>((end - it) / 16, 255);
+        __m128i counters = _mm_setzero_si128();
+
+        for (size_t i = 0; i < blocks; i++, it += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(block, bound));
+        }
+
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        total += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+
+    return total + countGreaterScalar(it, end, value);
+}
+
+__attribute__((target("avx2")))
+inline const uint8_t* findAvx2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m256i needle = _mm256_set1_epi8(char(value));
+    const uint8_t* it = begin;
+
+    for (; end - it >= 32; it += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+
+        if (mask != 0) {
+            return it + __builtin_ctz(mask);
+        }
+    }
+
+    return findSse2(it, end, value);
+}
+
+__attribute__((target("avx2")))
+inline const uint8_t* rfindAvx2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m256i needle = _mm256_set1_epi8(char(value));
+    const uint8_t* it = end;
+
+    for (; it - begin >= 32; it -= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it - 32));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+
+        if (mask != 0) {
+            return it - 32 + (31 - __builtin_clz(mask));
+        }
+    }
+
+    const uint8_t* result = rfindSse2(begin, it, value);
+    return result == it ? end : result;
+}
+
+__attribute__((target("avx2")))
+inline size_t countAvx2(const uint8_t* begin, const uint8_t* end, uint8_t value) {
+    const __m256i needle = _mm256_set1_epi8(char(value));
+    const uint8_t* it = begin;
+    size_t total = 0;
+
+    while (end - it >= 32) {
+        // the byte counters overflow after 255 blocks
+        size_t blocks = std::min<size_t>((end - it) / 32, 255);
+        __m256i counters = _mm256_setzero_si256();
+
+        for (size_t i = 0; i < blocks; i++, it += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(block, needle));
+        }
+
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        total += _mm256_extract_epi16(sums, 0) + _mm256_extract_epi16(sums, 4)
+            + _mm256_extract_epi16(sums, 8) + _mm256_extract_epi16(sums, 12);
+    }
+
+    return total + countSse2(it, end, value);
+}
+
+__attribute__((target("avx2")))
+inline size_t countGreaterAvx2(const uint8_t* begin, const uint8_t* end, int8_t value) {
+    const __m256i bound = _mm256_set1_epi8(value);
+    const uint8_t* it = begin;
+    size_t total = 0;
+
+    while (end - it >= 32) {
+        // the byte counters overflow after 255 blocks
+        size_t blocks = std::min<size_t>((end - it) / 32, 255);
+        __m256i counters = _mm256_setzero_si256();
+
+        for (size_t i = 0; i < blocks; i++, it += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpgt_epi8(block, bound));
+        }
+
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        total += _mm256_extract_epi16(sums, 0) + _mm256_extract_epi16(sums, 4)
+            + _mm256_extract_epi16(sums, 8) + _mm256_extract_epi16(sums, 12);
+    }
+
+    return total + countGreaterSse2(it, end, value);
+}
+
+__attribute__((target("avx2")))
+inline size_t rankAvx2(const uint64_t* begin, const uint64_t* end, uint64_t value) {
+    const __m256i needle = _mm256_set1_epi64x(int64_t(value));
+    const uint64_t* it = begin;
+    size_t total = 0;
+
+    for (; end - it >= 4; it += 4) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(block, needle)));
+
+        total += 4 - __builtin_popcount(mask);
+    }
+
+    return total + rankScalar(it, end, value);
+}
+
+#endif
+
+/// Returns the best kernels supported by this cpu
+inline const Kernels& kernels() {
+    static const Kernels kernels = [] {
+#ifdef ROPE_SEARCH_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernels { findAvx2, rfindAvx2, countAvx2, rankAvx2, countGreaterAvx2 };
+        }
+
+        // sse2 lacks a 64 bit compare
+        return Kernels { findSse2, rfindSse2, countSse2, rankScalar, countGreaterSse2 };
+#else
+        return Kernels { findScalar, rfindScalar, countScalar, rankScalar, countGreaterScalar };
+#endif
+    }();
+
+    return kernels;
+}
+
+template <typename T>
+const T* find(const T* begin, const T* end, const T& value) {
+    if constexpr (Bytewise<T>) {
+        auto bytes = reinterpret_cast<const uint8_t*>(begin);
+        auto result = kernels().find(bytes, bytes + (end - begin), uint8_t(value));
+
+        return begin + (result - bytes);
+    } else {
+        return std::find(begin, end, value);
+    }
+}
+
+template <typename T>
+const T* rfind(const T* begin, const T* end, const T& value) {
+    if constexpr (Bytewise<T>) {
+        auto bytes = reinterpret_cast<const uint8_t*>(begin);
+        auto result = kernels().rfind(bytes, bytes + (end - begin), uint8_t(value));
+
+        return begin + (result - bytes);
+    } else {
+        for (const T* it = end; it != begin;) {
+            if (*--it == value) {
+                return it;
+            }
+        }
+
+        return end;
+    }
+}
+
+template <typename T>
+size_t count(const T* begin, const T* end, const T& value) {
+    if constexpr (Bytewise<T>) {
+        auto bytes = reinterpret_cast<const uint8_t*>(begin);
+        return kernels().count(bytes, bytes + (end - begin), uint8_t(value));
+    } else {
+        return std::count(begin, end, value);
+    }
+}
+
+inline size_t rank(const uint64_t* begin, const uint64_t* end, uint64_t value) {
+    return kernels().rank(begin, end, value);
+}
+
+inline size_t countGreater(const uint8_t* begin, const uint8_t* end, int8_t value) {
+    return kernels().countGreater(begin, end, value);
+}
+
+} // namespace Search
+
+} // namespace Rope
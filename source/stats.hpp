@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/// Counts the provided number of events of a counter, see Rope::Counters
+/// Expands to nothing unless ROPE_COUNTERS is defined
+/// The macro changes the bodies of inline functions, so it is a whole-program setting: every translation unit
+/// must agree on it, best by passing -DROPE_COUNTERS to the compiler, or the program violates the one definition rule
+#ifdef ROPE_COUNTERS
+#define ROPE_COUNT(counter, count) ::Rope::Counters::global().counter.fetch_add(count, std::memory_order_relaxed)
+#else
+#define ROPE_COUNT(counter, count) ((void) 0)
+#endif
+
+/// The rope namespace
+namespace Rope {
+
+/// The statistics of the structure of a rope
+struct Stats {
+    /// The number of buckets of the fill histogram
+    static constexpr size_t Buckets = 10;
+
+    /// The height of the tree
+    size_t height = 0;
+    /// The number of inner and outer nodes
+    size_t nodes = 0;
+    /// The number of outer nodes
+    size_t leaves = 0;
+    /// The number of leaves referencing a mapped file or an adopted array instead of owning their data
+    size_t mapped = 0;
+    /// The number of nodes shared with other ropes, their subtrees are counted as well
+    size_t shared = 0;
+    /// The number of leaves by the tenth of their capacity they fill, full leaves count to the last bucket
+    std::array<size_t, Buckets> fill = {};
+    /// The number of bytes allocated for the nodes and the leaf buffers
+    size_t used = 0;
+    /// The number of bytes of data
+    size_t live = 0;
+
+    /// Returns the ratio of live to used bytes
+    double utilization() const;
+};
+
+/// The counters of the hot paths shared by all ropes
+/// They are only compiled in if ROPE_COUNTERS is defined for the whole program, see ROPE_COUNT,
+/// otherwise they stay zero and counting costs nothing
+struct Counters {
+    /// The number of allocated nodes
+    std::atomic<size_t> allocations;
+    /// The number of leaves merged into their neighbour
+    std::atomic<size_t> merges;
+    /// The number of leaves split in two
+    std::atomic<size_t> splits;
+    /// The number of rotations
+    std::atomic<size_t> rotations;
+    /// The number of calls to at
+    std::atomic<size_t> lookups;
+    /// The number of nodes visited by calls to at, divided by lookups the nodes visited per at
+    std::atomic<size_t> visits;
+
+    /// Returns the counters shared by all ropes
+    static Counters& global();
+
+    /// Resets every counter to zero
+    void reset();
+};
+
+inline double Stats::utilization() const {
+    return used > 0
+        ? double(live) / used
+        : 1.0;
+}
+
+inline Counters& Counters::global() {
+    static Counters counters = {};
+    return counters;
+}
+
+inline void Counters::reset() {
+    for (std::atomic<size_t>* counter : {&allocations, &merges, &splits, &rotations, &lookups, &visits}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace Rope
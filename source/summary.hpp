@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "search.hpp"
+
+/// The rope namespace
+namespace Rope {
+
+/// The summaries kept in every node of the rope
+/// A summary is a monoid over the data of a subtree:
+///     typedef ... Value;
+///     static Value identity();
+///     static Value combine(const Value& left, const Value& right);
+///     static Value summarize(std::span<const TData> data);
+namespace Summary {
+
+/// The summary that keeps nothing
+struct None {
+    /// The empty value
+    struct Value {};
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+};
+
+/// The summary that keeps the maximum
+template <typename TData>
+struct Max {
+    typedef TData Value;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    static Value summarize(std::span<const TData> data);
+};
+
+/// The summary that keeps the number of line breaks
+struct Lines {
+    typedef size_t Value;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+};
+
+/// The summary that keeps the number of UTF-8 codepoints, every byte that is not a continuation byte
+struct Codepoints {
+    typedef size_t Value;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+};
+
+/// The summary that keeps the number of UTF-16 code units of UTF-8 data
+/// Every codepoint counts one unit, and another one if it takes four bytes
+struct Utf16 {
+    typedef size_t Value;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+};
+
+/// The summary that keeps a polynomial hash modulo the prime 2^61 - 1
+/// The base is chosen randomly once per process, so for any two different
+/// sequences of length n the hashes collide with a probability of at most n / 2^61
+struct Hash {
+    /// The hash and the base to the power of the length
+    struct Value {
+        /// The hash of the data
+        uint64_t hash;
+        /// The base to the power of the length of the data
+        uint64_t power;
+    };
+
+    /// The modulus
+    static constexpr uint64_t Modulus = (uint64_t(1) << 61) - 1;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+
+    /// Returns the base of the current process
+    static uint64_t base();
+
+private:
+    static uint64_t reduce(uint64_t value);
+
+    static uint64_t multiply(uint64_t left, uint64_t right);
+
+    template <typename TData>
+    static uint64_t digit(const TData& value);
+};
+
+/// The summary that keeps all of the provided summaries
+template <typename... TSummaries>
+struct Tuple {
+    typedef std::tuple<typename TSummaries::Value...> Value;
+
+    static Value identity();
+
+    static Value combine(const Value& left, const Value& right);
+
+    template <typename TData>
+    static Value summarize(std::span<const TData> data);
+
+private:
+    template <size_t... TIndices>
+    static Value combine(const Value& left, const Value& right, std::index_sequence<TIndices...>);
+};
+
+/// The index of TPart within TSummary, or the number of parts if not contained
+template <typename TPart, typename TSummary>
+struct Index : std::integral_constant<size_t, std::is_same_v<TPart, TSummary> ? 0 : 1> {};
+
+template <typename TPart, typename TFirst, typename... TRest>
+struct Index<TPart, Tuple<TFirst, TRest...>>
+    : std::integral_constant<size_t, std::is_same_v<TPart, TFirst> ? 0 : 1 + Index<TPart, Tuple<TRest...>>::value> {};
+
+template <typename TPart>
+struct Index<TPart, Tuple<>> : std::integral_constant<size_t, 0> {};
+
+/// True if TSummary is or contains TPart
+template <typename TPart, typename TSummary>
+constexpr bool Contains = std::is_same_v<TPart, TSummary>;
+
+template <typename TPart, typename... TSummaries>
+constexpr bool Contains<TPart, Tuple<TSummaries...>> = (std::is_same_v<TPart, TSummaries> || ...);
+
+/// Returns the value of TPart within a value of TSummary
+template <typename TPart, typename TSummary>
+const typename TPart::Value& get(const typename TSummary::Value& value);
+
+inline None::Value None::identity() {
+    return Value();
+}
+
+inline None::Value None::combine(const Value&, const Value&) {
+    return Value();
+}
+
+template <typename TData>
+None::Value None::summarize(std::span<const TData>) {
+    return Value();
+}
+
+template <typename TData>
+Max<TData>::Value Max<TData>::identity() {
+    return std::numeric_limits<TData>::lowest();
+}
+
+template <typename TData>
+Max<TData>::Value Max<TData>::combine(const Value& left, const Value& right) {
+    return std::max(left, right);
+}
+
+template <typename TData>
+Max<TData>::Value Max<TData>::summarize(std::span<const TData> data) {
+    return data.empty()
+        ? identity()
+        : *std::max_element(data.begin(), data.end());
+}
+
+inline Lines::Value Lines::identity() {
+    return 0;
+}
+
+inline Lines::Value Lines::combine(const Value& left, const Value& right) {
+    return left + right;
+}
+
+template <typename TData>
+Lines::Value Lines::summarize(std::span<const TData> data) {
+    return Search::count(data.data(), data.data() + data.size(), TData('\n'));
+}
+
+inline Codepoints::Value Codepoints::identity() {
+    return 0;
+}
+
+inline Codepoints::Value Codepoints::combine(const Value& left, const Value& right) {
+    return left + right;
+}
+
+template <typename TData>
+Codepoints::Value Codepoints::summarize(std::span<const TData> data) {
+    static_assert(sizeof(TData) == 1, "codepoints are only counted in UTF-8 data");
+
+    auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+
+    // the continuation bytes 0x80 to 0xBF are the signed bytes up to -65
+    return Search::countGreater(bytes, bytes + data.size(), -65);
+}
+
+inline Utf16::Value Utf16::identity() {
+    return 0;
+}
+
+inline Utf16::Value Utf16::combine(const Value& left, const Value& right) {
+    return left + right;
+}
+
+template <typename TData>
+Utf16::Value Utf16::summarize(std::span<const TData> data) {
+    static_assert(sizeof(TData) == 1, "code units are only counted in UTF-8 data");
+
+    auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+    auto end = bytes + data.size();
+
+    // the leading bytes of four byte sequences 0xF0 to 0xFF are the signed bytes from -16 to -1
+    return Search::countGreater(bytes, end, -65)
+        + Search::countGreater(bytes, end, -17)
+        - Search::countGreater(bytes, end, -1);
+}
+
+inline Hash::Value Hash::identity() {
+    return {0, 1};
+}
+
+inline Hash::Value Hash::combine(const Value& left, const Value& right) {
+    return {
+        reduce(multiply(left.hash, right.power) + right.hash),
+        multiply(left.power, right.power)
+    };
+}
+
+template <typename TData>
+Hash::Value Hash::summarize(std::span<const TData> data) {
+    uint64_t base = Hash::base();
+    Value value = identity();
+
+    for (const TData& element : data) {
+        value.hash = reduce(multiply(value.hash, base) + digit(element));
+        value.power = multiply(value.power, base);
+    }
+
+    return value;
+}
+
+inline uint64_t Hash::base() {
+    static const uint64_t base = [] {
+        std::random_device device;
+        std::uniform_int_distribution<uint64_t> distribution(1 << 16, Modulus - 1);
+
+        return distribution(device);
+    }();
+
+    return base;
+}
+
+inline uint64_t Hash::reduce(uint64_t value) {
+    value = (value & Modulus) + (value >> 61);
+    return value >= Modulus ? value - Modulus : value;
+}
+
+inline uint64_t Hash::multiply(uint64_t left, uint64_t right) {
+    unsigned __int128 product = static_cast<unsigned __int128>(left) * right;
+    return reduce((static_cast<uint64_t>(product) & Modulus) + static_cast<uint64_t>(product >> 61));
+}
+
+template <typename TData>
+uint64_t Hash::digit(const TData& value) {
+    uint64_t result;
+
+    if constexpr (std::is_same_v<TData, bool>) {
+        result = value;
+    } else if constexpr (std::is_integral_v<TData> || std::is_enum_v<TData>) {
+        // widening the unsigned type avoids sign extending negative chars onto small digits
+        result = static_cast<std::make_unsigned_t<TData>>(value);
+    } else {
+        result = std::hash<TData>()(value);
+    }
+
+    // zero digits would make leading zeros invisible
+    return reduce(reduce(result) + 1);
+}
+
+template <typename... TSummaries>
+Tuple<TSummaries...>::Value Tuple<TSummaries...>::identity() {
+    return Value(TSummaries::identity()...);
+}
+
+template <typename... TSummaries>
+Tuple<TSummaries...>::Value Tuple<TSummaries...>::combine(const Value& left, const Value& right) {
+    return combine(left, right, std::index_sequence_for<TSummaries...>());
+}
+
+template <typename... TSummaries>
+template <typename TData>
+Tuple<TSummaries...>::Value Tuple<TSummaries...>::summarize(std::span<const TData> data) {
+    return Value(TSummaries::summarize(data)...);
+}
+
+template <typename... TSummaries>
+template <size_t... TIndices>
+Tuple<TSummaries...>::Value Tuple<TSummaries...>::combine(const Value& left, const Value& right, std::index_sequence<TIndices...>) {
+    return Value(TSummaries::combine(std::get<TIndices>(left), std::get<TIndices>(right))...);
+}
+
+template <typename TPart, typename TSummary>
+const typename TPart::Value& get(const typename TSummary::Value& value) {
+    static_assert(Contains<TPart, TSummary>, "the summary does not contain the part");
+
+    if constexpr (std::is_same_v<TPart, TSummary>) {
+        return value;
+    } else {
+        return std::get<Index<TPart, TSummary>::value>(value);
+    }
+}
+
+} // namespace Summary
+
+} // namespace Rope
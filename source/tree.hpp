@@ -1,62 +1,607 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <compare>
+#include <istream>
+#include <iterator>
+#include <span>
+#include <type_traits>
 #include <stddef.h>
-
+#include <stdint.h>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "allocator.hpp"
+#include "parallel.hpp"
+#include "search.hpp"
+#include "stats.hpp"
+#include "summary.hpp"
+
+/// The rope namespace
 namespace Rope {
 
-template <typename TData, size_t TDataSize = 1024>
+/// The rope data structure with fixed size leaves
+/// The tree is kept height balanced (AVL) by every operation
+/// Every node keeps the TSummary of its subtree
+/// The nodes and leaf buffers are allocated by TAllocator
+/// Nodes are reference counted and shared between copies, every mutation
+/// copies the nodes on its path that are shared (copy-on-write)
+/// A rope of at most InlineSize data keeps it in an inline leaf without allocating
+template <typename TData, size_t TDataSize = 1024, typename TSummary = Summary::None, typename TAllocator = PoolAllocator<>>
 class Rope {
-    typedef Rope<TData, TDataSize> TRope;
-
-    constexpr size_t MinSize = TDataSize >> 2;
-    constexpr size_t MaxSize = TDataSize;
-
+    typedef Rope<TData, TDataSize, TSummary, TAllocator> TRope;
+
+    /// The minimum size of a leaf that is not the only leaf
+    static constexpr size_t MinSize = TDataSize >> 2;
+    /// The capacity of a leaf
+    static constexpr size_t MaxSize = TDataSize;
+    /// The maximum height of a tree, far above what fits into memory
+    static constexpr size_t MaxHeight = 64;
+    /// The minimum size of a subtree that is built on its own thread
+    static constexpr size_t ParallelSize = size_t(1) << 20;
+    /// The capacity of the inline leaf
+    static constexpr size_t InlineSize = std::min(MaxSize, std::max<size_t>(1, 64 / sizeof(TData)));
+    /// True if the data may be modified in place, which would outdate a summary
+    static constexpr bool Writable = std::is_same_v<TSummary, Summary::None>;
+    /// True if the data is UTF-8, whose sequences are then never cut by insert, remove, split, apply and the cursor
+    static constexpr bool Utf8 = Summary::Contains<Summary::Codepoints, TSummary> || Summary::Contains<Summary::Utf16, TSummary>;
+
+    static_assert(MinSize > 0, "TDataSize must be at least 4");
+
+    /// The base struct for inner and outer nodes
     struct Node {
+        /// True if it is an inner node
         bool inner;
+        /// The height of the subtree, zero for outer nodes
+        uint8_t height;
+        /// The number of references to the node
+        std::atomic<uint32_t> refs;
 
+        /// The size of the subtree
         size_t size;
-        uint8_t height;
+        /// The summary of the subtree
+        [[no_unique_address]] typename TSummary::Value summary;
     };
 
+    /// The inner node
     struct Inner : Node {
+        /// The left child of the inner node
         Node* left;
+        /// The right child of the inner node
         Node* right;
     };
 
+    /// The read-only mapping of a file or adopted array shared by the outer nodes referencing it
+    struct Mapping {
+        /// The number of outer nodes referencing the mapping
+        std::atomic<uint32_t> refs;
+        /// The address of the mapping
+        void* address;
+        /// The length of the mapping in bytes
+        size_t length;
+        /// True if the address is an array allocated with new[] instead of a mapped file
+        bool adopted;
+    };
+
+    /// The outer node
     struct Outer : Node {
+        /// The data of the node with a capacity of MaxSize, or a slice of the mapping
         TData* data;
+        /// The mapping the data belongs to, null if the node owns the data
+        /// A mapped node is copied into owned data before it is modified
+        Mapping* mapping;
+    };
+
+    /// The random access iterator for the rope
+    /// It keeps the path to the current leaf and walks the leaf by pointer
+    /// A mutable iterator, see mutableIterator, copies the shared nodes of every leaf it enters,
+    /// copying or modifying the rope invalidates it
+    template <typename TOther>
+    class Iterator {
+        /// True if the data may be modified through the iterator
+        static constexpr bool Mutable = !std::is_const_v<TOther>;
+
+        /// The root of the rope
+        Node** root;
+        /// The nodes from the root to the current leaf
+        Node* path[MaxHeight + 1];
+        /// The depth of the current leaf
+        size_t depth;
+        /// The index of the first data of the current leaf
+        size_t offset;
+
+        /// The first data of the current leaf
+        TOther* first;
+        /// The end of the current leaf
+        TOther* last;
+        /// The current data, only equal to last at the end of the rope
+        TOther* current;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef std::remove_const_t<TOther> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef TOther* pointer;
+        typedef TOther& reference;
+
+        /// Constructs a singular iterator
+        Iterator();
+
+        /// Constructs an iterator at the provided index
+        Iterator(Node** root, size_t index);
+
+        /// Returns a ref to the current data
+        TOther& operator*() const;
+
+        /// Returns a pointer to the current data
+        TOther* operator->() const;
+
+        /// Returns a ref to the data at the provided distance
+        TOther& operator[](difference_type distance) const;
+
+        /// Increments this iterator
+        Iterator<TOther>& operator++();
+
+        /// Increments this iterator and returns the previous one
+        Iterator<TOther> operator++(int);
+
+        /// Decrements this iterator
+        Iterator<TOther>& operator--();
+
+        /// Decrements this iterator and returns the previous one
+        Iterator<TOther> operator--(int);
+
+        /// Moves this iterator by the provided distance
+        Iterator<TOther>& operator+=(difference_type distance);
+
+        /// Moves this iterator back by the provided distance
+        Iterator<TOther>& operator-=(difference_type distance);
+
+        /// Returns an iterator moved by the provided distance
+        Iterator<TOther> operator+(difference_type distance) const;
+
+        /// Returns an iterator moved back by the provided distance
+        Iterator<TOther> operator-(difference_type distance) const;
+
+        /// Returns the distance between the two iterators
+        difference_type operator-(const Iterator<TOther>& other) const;
+
+        /// Returns true if the two iterators are the same
+        bool operator==(const Iterator<TOther>& other) const;
+
+        /// Compares the positions of the two iterators
+        std::strong_ordering operator<=>(const Iterator<TOther>& other) const;
+
+        /// Returns an iterator moved by the provided distance
+        friend Iterator<TOther> operator+(difference_type distance, const Iterator<TOther>& iterator) {
+            return iterator + distance;
+        }
+
+        /// Moves this iterator to the provided index in O(log n)
+        void seek(size_t index);
+
+        /// Returns the index of this iterator
+        size_t index() const;
+
+        /// Returns the data from this iterator to the end of its leaf
+        std::span<TOther> chunk() const;
+
+        /// Moves this iterator to the beginning of the next leaf
+        void nextChunk();
+
+    private:
+        void descend(size_t index);
+
+        void next();
+
+        void previous();
+    };
+
+public:
+    typedef Iterator<std::conditional_t<Writable, TData, const TData>> Iter;
+    typedef Iterator<const TData> ConstIter;
+    typedef typename TSummary::Value Value;
+
+    /// The index returned if nothing was found
+    static constexpr size_t NotFound = size_t(-1);
+
+    /// The reference to data returned by the index operator
+    /// Reading it keeps the shared nodes shared, assigning to it calls set
+    class Reference {
+        friend TRope;
+
+        /// The rope of the data
+        TRope* rope;
+        /// The index of the data
+        size_t index;
+
+        Reference(TRope& rope, size_t index);
+
+    public:
+        Reference(const Reference& other) = default;
+
+        /// Returns the data
+        operator const TData&() const;
+
+        /// Replaces the data, see set
+        Reference& operator=(const TData& value);
+
+        /// Replaces the data by the data of the provided reference
+        Reference& operator=(const Reference& other);
+
+        /// Returns true if the data equals the provided value
+        template <typename TOther>
+        friend bool operator==(const Reference& reference, const TOther& value)
+            requires (!std::is_same_v<TOther, Reference>) && requires (const TData& data, const TOther& other) { data == other; }
+        {
+            return static_cast<const TData&>(reference) == value;
+        }
+    };
+
+    /// The edit replacing data of the rope, see apply
+    struct Edit {
+        /// The index of the replaced data in the rope before any edit
+        size_t index;
+        /// The number of removed data
+        size_t remove;
+        /// The inserted data
+        std::span<const TData> insert;
+    };
+
+    /// The builder creating a balanced rope from data arriving in pieces
+    /// The data is read straight into fresh leaves, every full leaf is linked
+    /// into perfect subtrees like a binary counter, finishing takes O(log n)
+    class Builder {
+        friend TRope;
+
+        /// The number of leaves filled by a single read
+        static constexpr size_t ReadBatch = 64;
+        /// The capacity of a leaf in bytes
+        static constexpr size_t MaxBytes = MaxSize * sizeof(TData);
+
+        /// The perfect subtrees, the one at level i has 2^i leaves or is null
+        Node* levels[MaxHeight];
+        /// The leaf being filled, may be null
+        Outer* leaf;
+        /// The number of bytes in the leaf being filled
+        size_t filled;
+
+    public:
+        /// Constructs an empty builder
+        Builder();
+
+        /// The destructor
+        ~Builder();
+
+        Builder(const Builder& other) = delete;
+
+        Builder& operator=(const Builder& other) = delete;
+
+        /// Appends a copy of the provided data
+        void append(const TData* data, size_t size);
+
+        /// Reads the provided file descriptor until its end
+        /// Throws a std::system_error if a read fails
+        void read(int fd);
+
+        /// Reads the provided stream until its end
+        void read(std::istream& is);
+
+        /// Returns the rope of all data appended so far and empties the builder
+        TRope build();
+
+    private:
+        Node* finish();
+
+        Outer* fresh();
+
+        void fill(size_t bytes);
+
+        void push();
+    };
+
+    /// The cursor for edits and reads that stay close to a position
+    /// It keeps the path to the leaf holding its position, edits within that
+    /// leaf neither allocate nor rebalance and only update the sizes and
+    /// summaries on the path, other edits fall back to the rope operations
+    /// Modifying the rope other than through the cursor invalidates it
+    class Cursor {
+        /// The rope of the cursor
+        TRope* rope;
+        /// The nodes from the root to the current leaf
+        Node* path[MaxHeight + 1];
+        /// The depth of the current leaf
+        size_t depth;
+        /// The index of the first data of the current leaf
+        size_t offset;
+        /// The index of the cursor
+        size_t position;
+
+    public:
+        /// Constructs a cursor at the provided index
+        Cursor(TRope& rope, size_t index);
+
+        /// Returns the index of the cursor
+        size_t index() const;
+
+        /// Moves the cursor to the provided index, in O(1) within the current leaf
+        void seek(size_t index);
+
+        /// Returns the data at the cursor, which must not be at the end of the rope
+        const TData& get();
+
+        /// Inserts the provided data at the cursor and moves the cursor behind it
+        /// Like insert of the rope, a UTF-8 rope first moves the cursor to the start of its sequence
+        void insert(const TData* data, size_t size);
+
+        /// Inserts the provided value at the cursor and moves the cursor behind it
+        void insert(const TData& value);
+
+        /// Removes the provided number of data behind the cursor
+        /// Like remove of the rope, a UTF-8 rope moves both ends to the start of their sequences
+        void remove(size_t count);
+
+    private:
+        Outer* leaf() const;
+
+        void descend(bool write);
+
+        Outer* prepare();
+
+        void propagate();
     };
 
+private:
+    /// The root node, the inline leaf if the size is at most InlineSize
     Node* root;
+    /// The inline leaf, it is empty while unused and never shared or part of a tree
+    Outer local;
+    /// The data of the inline leaf
+    TData buffer[InlineSize];
+
+    /// Constructs a rope with the provided root, which may be null
+    Rope(Node* node);
+
+    /// Makes the empty inline leaf the root
+    void initialize();
+
+    /// Returns the root as a node that can be part of a tree and empties the rope
+    Node* take();
+
+    /// Makes the provided node the root of the empty rope, small data is moved inline
+    void reset(Node* node);
+
+    size_t align(size_t index) const;
+
+    /// Copies the provided rope into the empty rope, sharing its nodes
+    void share(const TRope& other);
+
+    /// Moves the provided rope into the empty rope and empties it
+    void steal(TRope& other);
 
 public:
+    /// Constructs an empty rope
     Rope();
 
-    Rope(size_t size, TData* data);
+    /// Constructs a balanced rope by copying the provided data in linear time
+    /// Subtrees are built on up to the provided number of threads
+    Rope(size_t size, TData* data, size_t threads = 1);
+
+    /// Constructs a rope referencing the contents of the provided file without copying them
+    /// The file is mapped read-only and a leaf is only copied once it is modified
+    /// Throws a std::system_error if the file cannot be mapped
+    static TRope map(const char* path);
 
+    /// Constructs a rope taking ownership of the provided array allocated with new[] without copying it
+    /// The leaves reference the array like a mapped file, it is deleted once no leaf references it
+    /// Subtrees are built on up to the provided number of threads
+    static TRope adopt(size_t size, TData* data, size_t threads = 1);
+
+    /// The destructor
     ~Rope();
 
+    /// The copy constructor
+    /// The copy shares all nodes with the provided rope
     Rope(const TRope& other);
 
+    /// The move constructor
     Rope(TRope&& other);
 
+    /// The copy assignment operator
     TRope& operator=(const TRope& other);
 
+    /// The move assignment operator
     TRope& operator=(TRope&& other);
 
-    TData& operator[](size_t index);
+    /// The index operator
+    /// The data is only copied once it is assigned, see set
+    Reference operator[](size_t index);
+
+    /// The const index operator
+    const TData& operator[](size_t index) const;
+
+    /// Returns the data at the specified index
+    /// The data is only copied once it is assigned, see set
+    Reference at(size_t index);
+
+    /// Returns the const data at the specified index
+    const TData& at(size_t index) const;
+
+    /// Replaces the data at the specified index and updates the summaries
+    void set(size_t index, const TData& value);
+
+    /// Returns the summary of the entire rope
+    const Value& summary() const;
 
-    TData& at(size_t index);
+    /// Returns the summary of the data between the provided indices in O(log n)
+    Value summarize(size_t begin, size_t end) const;
 
-    TData* array();
+    /// Returns the first index whose summary of the data up to and including it
+    /// satisfies the provided monotone predicate, or the size if there is none
+    template <typename TPredicate>
+    size_t seek(TPredicate&& predicate) const;
 
+    /// Returns the number of lines, one more than the number of line breaks
+    size_t lineCount() const requires Summary::Contains<Summary::Lines, TSummary>;
+
+    /// Returns the index of the first data of the provided line, or the size if there is no such line
+    size_t lineStart(size_t line) const requires Summary::Contains<Summary::Lines, TSummary>;
+
+    /// Returns the line of the provided index
+    size_t lineOf(size_t index) const requires Summary::Contains<Summary::Lines, TSummary>;
+
+    /// Returns the line and column of the provided index
+    std::pair<size_t, size_t> lineColumn(size_t index) const requires Summary::Contains<Summary::Lines, TSummary>;
+
+    /// Returns the index of the provided line and column
+    size_t indexOf(size_t line, size_t column) const requires Summary::Contains<Summary::Lines, TSummary>;
+
+    /// Returns the number of UTF-8 codepoints
+    size_t codepointCount() const requires Summary::Contains<Summary::Codepoints, TSummary>;
+
+    /// Returns the number of codepoints starting before the provided index in O(log n)
+    size_t codepointOf(size_t index) const requires Summary::Contains<Summary::Codepoints, TSummary>;
+
+    /// Returns the index of the provided codepoint in O(log n), or the size if there is no such codepoint
+    size_t indexOfCodepoint(size_t codepoint) const requires Summary::Contains<Summary::Codepoints, TSummary>;
+
+    /// Returns the number of UTF-16 code units
+    size_t utf16Count() const requires Summary::Contains<Summary::Utf16, TSummary>;
+
+    /// Returns the number of UTF-16 code units of the codepoints starting before the provided index in O(log n)
+    size_t utf16Of(size_t index) const requires Summary::Contains<Summary::Utf16, TSummary>;
+
+    /// Returns the index of the codepoint holding the provided UTF-16 code unit in O(log n),
+    /// or the size if there is no such code unit
+    size_t indexOfUtf16(size_t unit) const requires Summary::Contains<Summary::Utf16, TSummary>;
+
+    /// Returns the polynomial hash of the data between the provided indices in O(log n)
+    uint64_t hash(size_t begin, size_t end) const requires Summary::Contains<Summary::Hash, TSummary>;
+
+    /// Returns the first index at which both ropes differ, or the smaller size if one is a prefix of the other
+    /// Both trees are walked together and their data is compared in O(n),
+    /// subtrees shared by both ropes at the same index are skipped without comparing their data
+    size_t mismatch(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary>;
+
+    /// Compares both ropes lexicographically and returns a negative value, zero or a positive value
+    int compare(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary>;
+
+    /// True if both ropes hold the same data
+    /// Different sizes or hashes are rejected in O(1), otherwise the data is compared by mismatch
+    bool operator==(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary>;
+
+    /// Creates an array containing the entire data of the rope
+    TData* array() const;
+
+    /// Writes the entire data to the provided file descriptor
+    /// The leaves are gathered into batches of vectored writes without copying
+    /// Throws a std::system_error if a write fails
+    void writeTo(int fd) const;
+
+    /// Appends the provided rope
+    /// The provided rope is cleared during the process
     void append(TRope&& other);
 
+    /// Inserts the provided rope at the provided index
+    /// The provided rope is cleared during the process
     void insert(TRope&& other, size_t index);
 
+    /// Removes the data between the provided begin and end indices
     void remove(size_t begin, size_t end);
 
+    /// Applies the provided edits, sorted by index, not overlapping and within the rope, in a single pass
+    /// Only the subtrees holding an edit are rebuilt, the others are kept as they are
+    /// For UTF-8 text both ends of an edit move to the start of their sequences like insert and remove
+    void apply(std::span<const Edit> edits);
+
+    /// Splits the rope at the provided index
+    /// This rope is cleared during the process
     std::pair<TRope, TRope> split(size_t index);
 
-    size_t size();
+    /// Clears the rope
+    void clear();
+
+    /// Returns the size of the rope
+    size_t size() const;
+
+    /// Returns the height of the tree
+    size_t height() const;
+
+    /// Returns the statistics of the structure of the tree in O(n)
+    Stats stats() const;
+
+    /// Returns the number of bytes allocated for the nodes not shared with any other rope
+    /// Only those nodes are visited, so after editing a copy it takes time proportional to the edits
+    size_t exclusive() const;
+
+    /// Calls the function with the data of every leaf between the provided indices
+    /// The function may return false to stop, in which case false is returned
+    template <typename TFunction>
+    bool forEachChunk(size_t begin, size_t end, TFunction&& function) const;
+
+    /// Calls the function with the data and the index of every leaf between the provided indices
+    /// Subtrees of at least ParallelSize data are visited concurrently by the executor
+    template <typename TFunction, typename TExecutor = ThreadPool>
+    void parallelForEachChunk(size_t begin, size_t end, TFunction&& function, TExecutor& executor = ThreadPool::shared()) const;
+
+    /// Maps the data of every leaf between the provided indices and combines the results in order
+    /// Subtrees of at least ParallelSize data are reduced concurrently by the executor
+    template <typename TValue, typename TMap, typename TCombine, typename TExecutor = ThreadPool>
+    TValue parallelReduce(size_t begin, size_t end, TValue identity, TMap&& map, TCombine&& combine, TExecutor& executor = ThreadPool::shared()) const;
+
+    /// Copies the data between the provided indices to the destination concurrently
+    template <typename TExecutor = ThreadPool>
+    void parallelCopy(size_t begin, size_t end, TData* destination, TExecutor& executor = ThreadPool::shared()) const;
+
+    /// Creates an array containing the entire data of the rope, copied concurrently
+    template <typename TExecutor = ThreadPool>
+    TData* parallelArray(TExecutor& executor = ThreadPool::shared()) const;
+
+    /// Returns the index of the first value at or after the provided index
+    size_t find(const TData& value, size_t index = 0) const;
+
+    /// Returns the index of the first needle at or after the provided index
+    size_t find(std::span<const TData> needle, size_t index = 0) const;
+
+    /// Returns the index of the last value at or before the provided index
+    size_t rfind(const TData& value, size_t index = NotFound) const;
+
+    /// Returns the index of the last needle at or before the provided index
+    size_t rfind(std::span<const TData> needle, size_t index = NotFound) const;
+
+    /// Returns the number of values between the provided indices
+    size_t count(const TData& value, size_t begin = 0, size_t end = NotFound) const;
+
+    /// Returns a cursor at the provided index
+    Cursor cursor(size_t index = 0);
+
+    /// Returns the const iterator at the provided index
+    ConstIter iterator(size_t index) const;
+
+    /// Returns the const begin iterator
+    ConstIter begin() const;
+
+    /// Returns the const end iterator
+    ConstIter end() const;
+
+    /// Returns the mutable iterator at the provided index
+    /// It copies the shared nodes of every leaf it enters, reading through begin and end does not
+    Iter mutableIterator(size_t index);
+
+    /// Returns the mutable begin iterator, see mutableIterator
+    Iter mutableBegin();
+
+    /// Returns the mutable end iterator, see mutableIterator
+    Iter mutableEnd();
 
 private:
     static Inner* createInner(Node* left, Node* right);
@@ -65,339 +610,2434 @@ private:
 
     static Outer* createEmpty();
 
-    static Node* copy(Node* node);
+    static Outer* createMapped(size_t size, TData* data, Mapping* mapping);
+
+    static Outer* slice(Outer* outer, size_t begin, size_t end);
+
+    static Node* retain(Node* node);
+
+    static void release(Node* node);
+
+    static Node* mutate(Node* node);
 
-    static void destroy(Node* node);
 
     static void update(Inner* node);
 
+    static void update(Outer* node);
+
+    static void set(Node*& node, size_t index, const TData& value);
+
+    static Value summarize(const Node* node, size_t begin, size_t end);
+
+    static size_t mismatch(const Node* node, const Node* other, size_t end);
+
     static Node* combine(Outer* left, Outer* right);
 
     static Node* rotateLeft(Inner* inner);
 
     static Node* rotateRight(Inner* inner);
 
+    static Node* rebalance(Inner* inner);
+
     static std::pair<Inner*, Outer*> leftmost(Node* node);
 
     static std::pair<Inner*, Outer*> rightmost(Node* node);
 
-    static TData& at(Node* node, size_t index);
+    static Node* popLeftmost(Node* node, Outer*& leaf);
+
+    static Node* popRightmost(Node* node, Outer*& leaf);
+
+    static const TData& at(const Node* node, size_t index);
 
     static void array(Node* node, TData* array);
 
-    static Node* append(Node* left, Node* right);
+    static void stats(const Node* node, Stats& result);
 
-    static size_t size(Node* node);
-};
+    static size_t exclusive(const Node* node);
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Rope() 
-    : root(createEmpty())
-{
-    // empty
-}
+    template <typename TFunction>
+    static bool forEachChunkReverse(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function);
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Rope(size_t size, TData* data) 
-    : root(createOuter(size, data))
-{
-    // empty
-}
+    template <typename TFunction, typename TExecutor>
+    static void parallelForEachChunk(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function, TExecutor& executor);
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::~Rope() {
-    destroy(root);
-}
+    template <typename TValue, typename TMap, typename TCombine, typename TExecutor>
+    static TValue parallelReduce(const Node* node, size_t offset, size_t begin, size_t end, const TValue& identity, TMap& map, TCombine& combine, TExecutor& executor);
 
-template <typename TData, size_t TDataSize>
-TData& Rope<TData, TDataSize>::operator[](size_t index) {
-    return at(index);
-}
+    static Node* build(size_t size, TData* data, size_t count, size_t threads, Mapping* mapping = nullptr);
 
-template <typename TData, size_t TDataSize>
-TData& Rope<TData, TDataSize>::at(size_t index) {
-    return at(root, index);
-}
+    static Node* concat(Node* left, Node* right);
 
-template <typename TData, size_t TDataSize>
-TData *Rope<TData, TDataSize>::array() {
-    size_t size = size();
-    TData* result = new TData[size];
+    static Node* join(Node* left, Node* right);
 
-    array(root, result);
-    return result;
+    static std::pair<Node*, Node*> split(Node* node, size_t index);
+
+    static Node* apply(Node* node, size_t offset, size_t before, size_t after, std::span<const Edit> edits);
+
+    static size_t leading(const Node* node, size_t after);
+
+    static size_t trailing(const Node* node, size_t before);
+
+    static int height(Node* node);
+};
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Rope(Node* node) {
+    initialize();
+    reset(node);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Rope() {
+    initialize();
 }
 
-template <typename TData, size_t TDataSize>
-void Rope<TData, TDataSize>::append(TRope&& other) {
-    if (other.size() > 0) {
-        root = size() > 0
-            ? append(root, other.root)
-            : other.root;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Rope(size_t size, TData* data, size_t threads) {
+    initialize();
 
-        other.root = createEmpty();
+    if (size <= InlineSize) {
+        std::copy(data, data + size, buffer);
+        local.size = size;
+        update(&local);
+    } else {
+        root = build(size, data, (size + MaxSize - 1) / MaxSize, std::max<size_t>(threads, 1));
     }
 }
 
-template <typename TData, size_t TDataSize>
-size_t Rope<TData, TDataSize>::size() {
-    return size(root);
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::initialize() {
+    local.inner = false;
+    local.refs = 1;
+    local.size = 0;
+    local.height = 0;
+    local.data = buffer;
+    local.mapping = nullptr;
+
+    update(&local);
+    root = &local;
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Inner* Rope<TData, TDataSize>::createInner(Node* left, Node* right) {
-    Inner* inner = new Inner();
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::take() {
+    Node* node = root;
 
-    inner->inner = true;
-    inner->size = size(left);
-    inner->left = left;
-    inner->right = right;
+    if (root == &local) {
+        node = createOuter(local.size, buffer);
 
-    return inner;
+        local.size = 0;
+        update(&local);
+    }
+
+    root = &local;
+    return node;
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Outer* Rope<TData, TDataSize>::createOuter(size_t size, TData* data) {
-    Outer* outer = new Outer();
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::reset(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+
+    if (node->size > InlineSize) {
+        root = node;
+        return;
+    }
 
-    outer->inner = false;
-    outer->size = size;
-    outer->data = new TData[MaxSize];
+    array(node, buffer);
+    local.size = node->size;
 
-    std::copy(data, data + size, outer->data);
-    return outer;
+    update(&local);
+    release(node);
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Node* Rope<TData, TDataSize>::copy(Node* node) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        Node* left = copy(inner->left);
-        Node* right = copy(inner->right);
-
-        return createInner(left, right);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        return createOuter(outer->size, outer->data);
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::align(size_t index) const {
+    // a sequence takes at most four bytes, the first is never a continuation byte
+    for (size_t i = 0; i < 3 && index > 0 && index < size(); i++, index--) {
+        if ((static_cast<uint8_t>(at(index)) & 0xC0) != 0x80) {
+            break;
+        }
     }
+
+    return index;
 }
 
-template <typename TData, size_t TDataSize>
-void Rope<TData, TDataSize>::destroy(Node* node) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        
-        destroy(inner->left);
-        destroy(inner->right);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        delete outer->data;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::share(const TRope& other) {
+    if (other.root != &other.local) {
+        root = retain(other.root);
+        return;
     }
 
-    delete node;
+    std::copy(other.buffer, other.buffer + other.local.size, buffer);
+    local.size = other.local.size;
+    local.summary = other.local.summary;
 }
 
-template <typename TData, size_t TDataSize>
-void Rope<TData, TDataSize>::update(Inner *inner) {
-    inner->size = inner->left->size + inner->right->size;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::steal(TRope& other) {
+    if (other.root != &other.local) {
+        root = other.root;
+        other.root = &other.local;
+
+        return;
+    }
+
+    share(other);
+    other.clear();
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Node* Rope<TData, TDataSize>::combine(Outer* left, Outer* right) {
-    size_t total = left->size + right->size;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator> Rope<TData, TDataSize, TSummary, TAllocator>::map(const char* path) {
+    static_assert(std::is_trivially_copyable_v<TData>, "only trivially copyable data can be mapped");
 
-    if (total <= MaxSize) {
-        std::copy(right->data, right->data + right->size, left->data + left->size);
-        destroy(right);
+    int file = ::open(path, O_RDONLY | O_CLOEXEC);
 
-        return right;
+    if (file < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
     }
 
-    if (left->size < MinSize) {
-        size_t delta = MinSize - left->size;
+    struct stat info;
 
-        std::copy(right->data, right->data + delta, left->data + left->size);
-        std::copy(right->data + delta, right->data + right->size, right->data);
+    if (::fstat(file, &info) != 0) {
+        int error = errno;
+        ::close(file);
 
-        left->size = MinSize;
-        right->size -= delta;
-    } else if (right->size < MinSize) {
-        size_t delta = MinSize - right->size;
+        throw std::system_error(error, std::generic_category(), path);
+    }
 
-        std::copy(right->data, right->data + right->size, right->data + delta);
-        std::copy(left->data + left->size - delta, left->data + left->size, right->data);
+    size_t size = size_t(info.st_size) / sizeof(TData);
 
-        right->size = MinSize;
-        left->size -= delta;
+    if (size == 0) {
+        ::close(file);
+        return TRope();
     }
 
-    return createInner(left, right);
-}
+    void* address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    int error = errno;
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Node* Rope<TData, TDataSize>::rotateLeft(Inner* inner) {
-    Inner* pivot = static_cast<Inner*>(inner->right);
-    Node* tmp = pivot->left;
+    ::close(file);
 
-    inner->right = tmp;
-    pivot->left = inner;
+    if (address == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), path);
+    }
 
-    update(inner);
-    update(pivot);
+    Mapping* mapping = TAllocator::template create<Mapping>();
 
-    return pivot;
+    mapping->refs = 0;
+    mapping->address = address;
+    mapping->length = info.st_size;
+    mapping->adopted = false;
+
+    return TRope(build(size, static_cast<TData*>(address), (size + MaxSize - 1) / MaxSize, 1, mapping));
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Node* Rope<TData, TDataSize>::rotateRight(Inner* inner) {
-    Inner* pivot = static_cast<Inner*>(inner->left);
-    Node* tmp = pivot->right;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator> Rope<TData, TDataSize, TSummary, TAllocator>::adopt(size_t size, TData* data, size_t threads) {
+    if (size == 0) {
+        delete[] data;
+        return TRope();
+    }
 
-    inner->left = tmp;
-    pivot->right = inner;
+    Mapping* mapping = TAllocator::template create<Mapping>();
 
-    update(inner);
-    update(pivot);
+    mapping->refs = 0;
+    mapping->address = data;
+    mapping->length = size * sizeof(TData);
+    mapping->adopted = true;
 
-    return pivot;
+    return TRope(build(size, data, (size + MaxSize - 1) / MaxSize, threads, mapping));
 }
 
-template <typename TData, size_t TDataSize>
-std::pair<typename Rope<TData, TDataSize>::Inner*, typename Rope<TData, TDataSize>::Outer*> Rope<TData, TDataSize>::leftmost(Node* node)
-{
-    Inner* inner = nullptr;
-
-    while (node->inner) {
-        inner = static_cast<Inner*>(node);
-        node = inner->left;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::~Rope() {
+    if (root != &local) {
+        release(root);
     }
+}
 
-    Outer* outer = static_cast<Outer*>(node);
-    return {inner, outer};
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Rope(const TRope& other) {
+    initialize();
+    share(other);
 }
 
-template <typename TData, size_t TDataSize>
-std::pair<typename Rope<TData, TDataSize>::Inner*, typename Rope<TData, TDataSize>::Outer*> Rope<TData, TDataSize>::rightmost(Node* node)
-{
-    Inner* inner = nullptr;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Rope(TRope&& other) {
+    initialize();
+    steal(other);
+}
 
-    while (node->inner) {
-        inner = static_cast<Inner*>(node);
-        node = inner->right;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>& Rope<TData, TDataSize, TSummary, TAllocator>::operator=(const TRope& other) {
+    if (this != &other) {
+        clear();
+        share(other);
     }
 
-    Outer* outer = static_cast<Outer*>(node);
-    return {inner, outer};
+    return *this;
 }
 
-template <typename TData, size_t TDataSize>
-TData& Rope<TData, TDataSize>::at(Node* node, size_t index) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
-        return index < inner->size
-            ? at(inner->left, index)
-            : at(inner->right, index - inner->size);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        return outer->data[index];
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>& Rope<TData, TDataSize, TSummary, TAllocator>::operator=(TRope&& other) {
+    if (this != &other) {
+        clear();
+        steal(other);
     }
-}
 
-template <typename TData, size_t TDataSize>
-void Rope<TData, TDataSize>::array(Node* node, TData* array) {
-    if (node->inner) {
-        Inner* inner = static_cast<Inner*>(node);
+    return *this;
+}
 
-        array(inner->left, array);
-        array(inner->right, array + inner->size);
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference Rope<TData, TDataSize, TSummary, TAllocator>::operator[](size_t index) {
+    return at(index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference Rope<TData, TDataSize, TSummary, TAllocator>::at(size_t index) {
+    return Reference(*this, index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TDataSize, TSummary, TAllocator>::operator[](size_t index) const {
+    return at(index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TDataSize, TSummary, TAllocator>::at(size_t index) const {
+    return at(root, index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::set(size_t index, const TData& value) {
+    set(root, index, value);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference::Reference(TRope& rope, size_t index)
+    : rope(&rope), index(index) {}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference::operator const TData&() const {
+    return static_cast<const TRope*>(rope)->at(index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference& Rope<TData, TDataSize, TSummary, TAllocator>::Reference::operator=(const TData& value) {
+    rope->set(index, value);
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Reference& Rope<TData, TDataSize, TSummary, TAllocator>::Reference::operator=(const Reference& other) {
+    // the value is copied first as setting it may copy the leaf the other reference points into
+    return *this = TData(other);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+const Rope<TData, TDataSize, TSummary, TAllocator>::Value& Rope<TData, TDataSize, TSummary, TAllocator>::summary() const {
+    return root->summary;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Value Rope<TData, TDataSize, TSummary, TAllocator>::summarize(size_t begin, size_t end) const {
+    end = std::min(end, size());
+
+    return begin < end
+        ? summarize(root, begin, end)
+        : TSummary::identity();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TPredicate>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::seek(TPredicate&& predicate) const {
+    if (!predicate(root->summary)) {
+        return size();
+    }
+
+    const Node* node = root;
+    Value summary = TSummary::identity();
+    size_t index = 0;
+
+    while (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        Value left = TSummary::combine(summary, inner->left->summary);
+
+        if (predicate(left)) {
+            node = inner->left;
+        } else {
+            summary = std::move(left);
+            index += inner->left->size;
+            node = inner->right;
+        }
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+
+    for (size_t i = 0; i < outer->size; i++) {
+        summary = TSummary::combine(summary, TSummary::summarize(std::span<const TData>(outer->data + i, 1)));
+
+        if (predicate(summary)) {
+            return index + i;
+        }
+    }
+
+    return index + outer->size;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::lineCount() const requires Summary::Contains<Summary::Lines, TSummary> {
+    return Summary::get<Summary::Lines, TSummary>(root->summary) + 1;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::lineStart(size_t line) const requires Summary::Contains<Summary::Lines, TSummary> {
+    if (line == 0) {
+        return 0;
+    }
+
+    size_t index = seek([line](const Value& value) {
+        return Summary::get<Summary::Lines, TSummary>(value) >= line;
+    });
+
+    return std::min(index + 1, size());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::lineOf(size_t index) const requires Summary::Contains<Summary::Lines, TSummary> {
+    return Summary::get<Summary::Lines, TSummary>(summarize(0, index));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+std::pair<size_t, size_t> Rope<TData, TDataSize, TSummary, TAllocator>::lineColumn(size_t index) const requires Summary::Contains<Summary::Lines, TSummary> {
+    size_t line = lineOf(index);
+    return {line, index - lineStart(line)};
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::indexOf(size_t line, size_t column) const requires Summary::Contains<Summary::Lines, TSummary> {
+    return lineStart(line) + column;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::codepointCount() const requires Summary::Contains<Summary::Codepoints, TSummary> {
+    return Summary::get<Summary::Codepoints, TSummary>(root->summary);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::codepointOf(size_t index) const requires Summary::Contains<Summary::Codepoints, TSummary> {
+    return Summary::get<Summary::Codepoints, TSummary>(summarize(0, index));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::indexOfCodepoint(size_t codepoint) const requires Summary::Contains<Summary::Codepoints, TSummary> {
+    return seek([codepoint](const Value& value) {
+        return Summary::get<Summary::Codepoints, TSummary>(value) > codepoint;
+    });
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::utf16Count() const requires Summary::Contains<Summary::Utf16, TSummary> {
+    return Summary::get<Summary::Utf16, TSummary>(root->summary);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::utf16Of(size_t index) const requires Summary::Contains<Summary::Utf16, TSummary> {
+    return Summary::get<Summary::Utf16, TSummary>(summarize(0, index));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::indexOfUtf16(size_t unit) const requires Summary::Contains<Summary::Utf16, TSummary> {
+    return seek([unit](const Value& value) {
+        return Summary::get<Summary::Utf16, TSummary>(value) > unit;
+    });
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+uint64_t Rope<TData, TDataSize, TSummary, TAllocator>::hash(size_t begin, size_t end) const requires Summary::Contains<Summary::Hash, TSummary> {
+    return Summary::get<Summary::Hash, TSummary>(summarize(begin, end)).hash;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::mismatch(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary> {
+    size_t end = std::min(size(), other.size());
+
+    return mismatch(root, other.root, end);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+int Rope<TData, TDataSize, TSummary, TAllocator>::compare(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary> {
+    size_t index = mismatch(other);
+
+    if (index < size() && index < other.size()) {
+        return at(index) < other.at(index) ? -1 : 1;
+    }
+
+    return size() < other.size()
+        ? -1
+        : size() > other.size();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+bool Rope<TData, TDataSize, TSummary, TAllocator>::operator==(const TRope& other) const requires Summary::Contains<Summary::Hash, TSummary> {
+    return size() == other.size()
+        && Summary::get<Summary::Hash, TSummary>(root->summary).hash == Summary::get<Summary::Hash, TSummary>(other.root->summary).hash
+        && mismatch(other) == size();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+TData* Rope<TData, TDataSize, TSummary, TAllocator>::array() const {
+    TData* result = new TData[size()];
+
+    array(root, result);
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::writeTo(int fd) const {
+    static_assert(std::is_trivially_copyable_v<TData>, "only trivially copyable data can be written");
+
+    iovec batch[IOV_MAX];
+    size_t count = 0;
+
+    auto flush = [&] {
+        iovec* vector = batch;
+
+        while (count > 0) {
+            ssize_t written = ::writev(fd, vector, count);
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+
+            // skip the fully written buffers and advance into a partially written one
+            while (count > 0 && size_t(written) >= vector->iov_len) {
+                written -= vector->iov_len;
+                vector++;
+                count--;
+            }
+
+            if (count > 0) {
+                vector->iov_base = static_cast<char*>(vector->iov_base) + written;
+                vector->iov_len -= written;
+            }
+        }
+    };
+
+    forEachChunk(0, size(), [&](std::span<const TData> chunk) {
+        batch[count++] = {const_cast<TData*>(chunk.data()), chunk.size_bytes()};
+
+        if (count == IOV_MAX) {
+            flush();
+        }
+    });
+
+    flush();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::append(TRope&& other) {
+    insert(std::move(other), size());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::insert(TRope&& other, size_t index) {
+    if (this == &other || other.size() == 0) {
+        return;
+    }
+
+    index = std::min(index, size());
+
+    if constexpr (Utf8) {
+        index = align(index);
+    }
+
+    if (root == &local && other.root == &other.local && size() + other.size() <= InlineSize) {
+        std::copy_backward(buffer + index, buffer + local.size, buffer + local.size + other.local.size);
+        std::copy(other.buffer, other.buffer + other.local.size, buffer + index);
+
+        local.size += other.local.size;
+        update(&local);
+        other.clear();
+
+        return;
+    }
+
+    auto [left, right] = split(take(), index);
+    reset(join(join(left, other.take()), right));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::remove(size_t begin, size_t end) {
+    end = std::min(end, size());
+
+    if constexpr (Utf8) {
+        begin = align(begin);
+        end = align(end);
+    }
+
+    if (begin >= end) {
+        return;
+    }
+
+    if (root == &local) {
+        std::copy(buffer + end, buffer + local.size, buffer + begin);
+
+        local.size -= end - begin;
+        update(&local);
+
+        return;
+    }
+
+    auto [left, rest] = split(take(), begin);
+    auto [center, right] = split(rest, end - begin);
+
+    release(center);
+    reset(join(left, right));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::apply(std::span<const Edit> edits) {
+    if (edits.empty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < edits.size(); i++) {
+        assert(edits[i].index + edits[i].remove <= size());
+        assert(i == 0 || edits[i - 1].index + edits[i - 1].remove <= edits[i].index);
+    }
+
+    reset(apply(take(), 0, 0, 0, edits));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+std::pair<Rope<TData, TDataSize, TSummary, TAllocator>, Rope<TData, TDataSize, TSummary, TAllocator>> Rope<TData, TDataSize, TSummary, TAllocator>::split(size_t index) {
+    if constexpr (Utf8) {
+        index = align(index);
+    }
+
+    if (root == &local) {
+        index = std::min(index, size());
+
+        auto result = std::make_pair(TRope(index, buffer), TRope(local.size - index, buffer + index));
+        clear();
+
+        return result;
+    }
+
+    auto [left, right] = split(take(), index);
+    return std::make_pair(TRope(left), TRope(right));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::clear() {
+    if (root != &local) {
+        release(root);
+        root = &local;
+    }
+
+    local.size = 0;
+    update(&local);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::size() const {
+    return root->size;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::height() const {
+    return root->height;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Stats Rope<TData, TDataSize, TSummary, TAllocator>::stats() const {
+    Stats result;
+
+    result.height = height();
+    result.live = size() * sizeof(TData);
+
+    if (root == &local) {
+        // the inline leaf is part of the rope itself
+        result.nodes = 1;
+        result.leaves = 1;
+        result.fill[std::min(local.size * Stats::Buckets / InlineSize, Stats::Buckets - 1)]++;
+    } else {
+        stats(root, result);
+    }
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::exclusive() const {
+    return root != &local
+        ? exclusive(root)
+        : 0;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TFunction>
+bool Rope<TData, TDataSize, TSummary, TAllocator>::forEachChunk(size_t begin, size_t end, TFunction&& function) const {
+    end = std::min(end, size());
+
+    if (begin >= end) {
+        return true;
+    }
+
+    ConstIter it = iterator(begin);
+
+    while (begin < end) {
+        std::span<const TData> chunk = it.chunk();
+
+        if (chunk.size() > end - begin) {
+            chunk = chunk.first(end - begin);
+        }
+
+        if constexpr (std::is_same_v<std::invoke_result_t<TFunction&, std::span<const TData>>, bool>) {
+            if (!function(chunk)) {
+                return false;
+            }
+        } else {
+            function(chunk);
+        }
+
+        begin += chunk.size();
+        it.nextChunk();
+    }
+
+    return true;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TFunction, typename TExecutor>
+void Rope<TData, TDataSize, TSummary, TAllocator>::parallelForEachChunk(size_t begin, size_t end, TFunction&& function, TExecutor& executor) const {
+    end = std::min(end, size());
+
+    if (begin < end) {
+        parallelForEachChunk(root, 0, begin, end, function, executor);
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TValue, typename TMap, typename TCombine, typename TExecutor>
+TValue Rope<TData, TDataSize, TSummary, TAllocator>::parallelReduce(size_t begin, size_t end, TValue identity, TMap&& map, TCombine&& combine, TExecutor& executor) const {
+    end = std::min(end, size());
+
+    return begin < end
+        ? parallelReduce<TValue>(root, 0, begin, end, identity, map, combine, executor)
+        : identity;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TExecutor>
+void Rope<TData, TDataSize, TSummary, TAllocator>::parallelCopy(size_t begin, size_t end, TData* destination, TExecutor& executor) const {
+    parallelForEachChunk(begin, end, [&](std::span<const TData> chunk, size_t index) {
+        std::copy(chunk.begin(), chunk.end(), destination + index - begin);
+    }, executor);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TExecutor>
+TData* Rope<TData, TDataSize, TSummary, TAllocator>::parallelArray(TExecutor& executor) const {
+    TData* result = new TData[size()];
+    parallelCopy(0, size(), result, executor);
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::find(const TData& value, size_t index) const {
+    size_t result = NotFound;
+
+    forEachChunk(index, size(), [&](std::span<const TData> chunk) {
+        const TData* found = Search::find(chunk.data(), chunk.data() + chunk.size(), value);
+
+        if (found != chunk.data() + chunk.size()) {
+            result = index + (found - chunk.data());
+            return false;
+        }
+
+        index += chunk.size();
+        return true;
+    });
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::find(std::span<const TData> needle, size_t index) const {
+    if (needle.size() > size() || index > size() - needle.size()) {
+        return NotFound;
+    }
+
+    if (needle.empty()) {
+        return index;
+    }
+
+    // every candidate lies within [index, last]
+    size_t last = size() - needle.size();
+    ConstIter it = iterator(index);
+
+    while (index <= last) {
+        std::span<const TData> chunk = it.chunk();
+        const TData* begin = chunk.data();
+        const TData* end = begin + std::min(chunk.size(), last - index + 1);
+
+        for (const TData* candidate = begin; ; candidate++) {
+            candidate = Search::find(candidate, end, needle[0]);
+
+            if (candidate == end) {
+                break;
+            }
+
+            // a needle that straddles leaves is compared through the iterator
+            bool equal = size_t(chunk.data() + chunk.size() - candidate) >= needle.size()
+                ? std::equal(needle.begin(), needle.end(), candidate)
+                : std::equal(needle.begin(), needle.end(), it + (candidate - begin));
+
+            if (equal) {
+                return index + (candidate - begin);
+            }
+        }
+
+        index += chunk.size();
+        it.nextChunk();
+    }
+
+    return NotFound;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::rfind(const TData& value, size_t index) const {
+    size_t result = NotFound;
+
+    if (size() == 0) {
+        return result;
+    }
+
+    auto function = [&](std::span<const TData> chunk, size_t offset) {
+        const TData* found = Search::rfind(chunk.data(), chunk.data() + chunk.size(), value);
+
+        if (found != chunk.data() + chunk.size()) {
+            result = offset + (found - chunk.data());
+            return false;
+        }
+
+        return true;
+    };
+
+    forEachChunkReverse(root, 0, 0, std::min(index, size() - 1) + 1, function);
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::rfind(std::span<const TData> needle, size_t index) const {
+    size_t result = NotFound;
+
+    if (needle.size() > size()) {
+        return result;
+    }
+
+    // every candidate lies within [0, last]
+    size_t last = std::min(index, size() - needle.size());
+
+    if (needle.empty()) {
+        return last;
+    }
+
+    auto function = [&](std::span<const TData> chunk, size_t offset) {
+        const TData* begin = chunk.data();
+        const TData* end = begin + chunk.size();
+
+        for (const TData* candidate = end; candidate != begin; end = candidate) {
+            candidate = Search::rfind(begin, end, needle[0]);
+
+            if (candidate == end) {
+                break;
+            }
+
+            // only the part of a needle that straddles the chunk is compared through an iterator
+            size_t position = offset + (candidate - begin);
+            size_t prefix = std::min<size_t>(chunk.data() + chunk.size() - candidate, needle.size());
+
+            if (std::equal(needle.begin(), needle.begin() + prefix, candidate)
+                && std::equal(needle.begin() + prefix, needle.end(), iterator(position + prefix))) {
+                result = position;
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    forEachChunkReverse(root, 0, 0, last + 1, function);
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::count(const TData& value, size_t begin, size_t end) const {
+    size_t result = 0;
+
+    forEachChunk(begin, end, [&](std::span<const TData> chunk) {
+        result += Search::count(chunk.data(), chunk.data() + chunk.size(), value);
+    });
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Cursor Rope<TData, TDataSize, TSummary, TAllocator>::cursor(size_t index) {
+    return Cursor(*this, index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::ConstIter Rope<TData, TDataSize, TSummary, TAllocator>::iterator(size_t index) const {
+    return ConstIter(const_cast<Node**>(&root), index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::ConstIter Rope<TData, TDataSize, TSummary, TAllocator>::begin() const {
+    return ConstIter(const_cast<Node**>(&root), 0);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::ConstIter Rope<TData, TDataSize, TSummary, TAllocator>::end() const {
+    return ConstIter(const_cast<Node**>(&root), size());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iter Rope<TData, TDataSize, TSummary, TAllocator>::mutableIterator(size_t index) {
+    return Iter(&root, index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iter Rope<TData, TDataSize, TSummary, TAllocator>::mutableBegin() {
+    return Iter(&root, 0);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iter Rope<TData, TDataSize, TSummary, TAllocator>::mutableEnd() {
+    return Iter(&root, size());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Inner* Rope<TData, TDataSize, TSummary, TAllocator>::createInner(Node* left, Node* right) {
+    Inner* inner = TAllocator::template create<Inner>();
+
+    ROPE_COUNT(allocations, 1);
+
+    inner->inner = true;
+    inner->refs = 1;
+    inner->left = left;
+    inner->right = right;
+
+    update(inner);
+    return inner;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::createOuter(size_t size, TData* data) {
+    Outer* outer = TAllocator::template create<Outer>();
+
+    ROPE_COUNT(allocations, 1);
+
+    outer->inner = false;
+    outer->refs = 1;
+    outer->size = size;
+    outer->height = 0;
+    outer->data = TAllocator::template allocate<TData, MaxSize>();
+    outer->mapping = nullptr;
+
+    std::copy(data, data + size, outer->data);
+    update(outer);
+
+    return outer;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::createEmpty() {
+    return createOuter(0, nullptr);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::createMapped(size_t size, TData* data, Mapping* mapping) {
+    Outer* outer = TAllocator::template create<Outer>();
+
+    ROPE_COUNT(allocations, 1);
+
+    outer->inner = false;
+    outer->refs = 1;
+    outer->size = size;
+    outer->height = 0;
+    outer->data = data;
+    outer->mapping = mapping;
+
+    mapping->refs.fetch_add(1, std::memory_order_relaxed);
+    update(outer);
+
+    return outer;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::slice(Outer* outer, size_t begin, size_t end) {
+    return outer->mapping == nullptr
+        ? createOuter(end - begin, outer->data + begin)
+        : createMapped(end - begin, outer->data + begin, outer->mapping);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::retain(Node* node) {
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+    return node;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::release(Node* node) {
+    if (node == nullptr || node->refs.fetch_sub(1, std::memory_order_acq_rel) > 1) {
+        return;
+    }
+
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+
+        release(inner->left);
+        release(inner->right);
+
+        TAllocator::destroy(inner);
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+        Mapping* mapping = outer->mapping;
+
+        if (mapping == nullptr) {
+            TAllocator::template deallocate<TData, MaxSize>(outer->data);
+        } else if (mapping->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (mapping->adopted) {
+                delete[] static_cast<TData*>(mapping->address);
+            } else {
+                ::munmap(mapping->address, mapping->length);
+            }
+
+            TAllocator::destroy(mapping);
+        }
+
+        TAllocator::destroy(outer);
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::mutate(Node* node) {
+    bool mapped = !node->inner && static_cast<Outer*>(node)->mapping != nullptr;
+
+    if (!mapped && node->refs.load(std::memory_order_acquire) == 1) {
+        return node;
+    }
+
+    Node* copy;
+
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+        copy = createInner(retain(inner->left), retain(inner->right));
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+        copy = createOuter(outer->size, outer->data);
+    }
+
+    release(node);
+    return copy;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::update(Inner *inner) {
+    inner->size = inner->left->size + inner->right->size;
+    inner->height = std::max(inner->left->height, inner->right->height) + 1;
+    inner->summary = TSummary::combine(inner->left->summary, inner->right->summary);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::update(Outer* outer) {
+    outer->summary = TSummary::summarize(std::span<const TData>(outer->data, outer->size));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::set(Node*& node, size_t index, const TData& value) {
+    node = mutate(node);
+
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+
+        if (index < inner->left->size) {
+            set(inner->left, index, value);
+        } else {
+            set(inner->right, index - inner->left->size, value);
+        }
+
+        update(inner);
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+
+        outer->data[index] = value;
+        update(outer);
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Value Rope<TData, TDataSize, TSummary, TAllocator>::summarize(const Node* node, size_t begin, size_t end) {
+    if (begin == 0 && end == node->size) {
+        return node->summary;
+    }
+
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        size_t middle = inner->left->size;
+
+        if (end <= middle) {
+            return summarize(inner->left, begin, end);
+        }
+
+        if (begin >= middle) {
+            return summarize(inner->right, begin - middle, end - middle);
+        }
+
+        return TSummary::combine(
+            summarize(inner->left, begin, middle),
+            summarize(inner->right, 0, end - middle));
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+    return TSummary::summarize(std::span<const TData>(outer->data + begin, end - begin));
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::mismatch(const Node* node, const Node* other, size_t end) {
+    // both stacks hold the subtrees still to visit in order, the one on top starts at the index of its side,
+    // the larger of both tops is split until they are the same node or both leaves
+    const Node* left[MaxHeight + 1] = {node};
+    const Node* right[MaxHeight + 1] = {other};
+    size_t leftDepth = 1;
+    size_t rightDepth = 1;
+    size_t leftIndex = 0;
+    size_t rightIndex = 0;
+    size_t index = 0;
+
+    while (index < end) {
+        const Node* first = left[leftDepth - 1];
+        const Node* second = right[rightDepth - 1];
+
+        if (first == second && leftIndex == index && rightIndex == index) {
+            index += first->size;
+            leftIndex = index;
+            rightIndex = index;
+            leftDepth--;
+            rightDepth--;
+        } else if (first->inner && (first->size >= second->size || !second->inner)) {
+            const Inner* inner = static_cast<const Inner*>(first);
+
+            left[leftDepth - 1] = inner->right;
+            left[leftDepth++] = inner->left;
+        } else if (second->inner) {
+            const Inner* inner = static_cast<const Inner*>(second);
+
+            right[rightDepth - 1] = inner->right;
+            right[rightDepth++] = inner->left;
+        } else {
+            // both leaves hold the data from index on, compare until the shorter one ends
+            const TData* data = static_cast<const Outer*>(first)->data + index - leftIndex;
+            const TData* otherData = static_cast<const Outer*>(second)->data + index - rightIndex;
+            size_t leftEnd = leftIndex + first->size;
+            size_t rightEnd = rightIndex + second->size;
+            size_t count = std::min({leftEnd, rightEnd, end}) - index;
+            size_t equal = std::mismatch(data, data + count, otherData).first - data;
+
+            if (equal < count) {
+                return index + equal;
+            }
+
+            index += count;
+
+            if (index == leftEnd) {
+                leftIndex = leftEnd;
+                leftDepth--;
+            }
+
+            if (index == rightEnd) {
+                rightIndex = rightEnd;
+                rightDepth--;
+            }
+        }
+    }
+
+    return end;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::combine(Outer* left, Outer* right) {
+    size_t total = left->size + right->size;
+
+    if (total <= MaxSize) {
+        ROPE_COUNT(merges, 1);
+
+        left = static_cast<Outer*>(mutate(left));
+
+        std::copy(right->data, right->data + right->size, left->data + left->size);
+        left->size = total;
+        update(left);
+        release(right);
+
+        return left;
+    }
+
+    if (left->size < MinSize || right->size < MinSize) {
+        left = static_cast<Outer*>(mutate(left));
+        right = static_cast<Outer*>(mutate(right));
+    }
+
+    if (left->size < MinSize) {
+        size_t delta = MinSize - left->size;
+
+        std::copy(right->data, right->data + delta, left->data + left->size);
+        std::copy(right->data + delta, right->data + right->size, right->data);
+
+        left->size = MinSize;
+        right->size -= delta;
+    } else if (right->size < MinSize) {
+        size_t delta = MinSize - right->size;
+
+        std::copy_backward(right->data, right->data + right->size, right->data + MinSize);
+        std::copy(left->data + left->size - delta, left->data + left->size, right->data);
+
+        right->size = MinSize;
+        left->size -= delta;
+    }
+
+    update(left);
+    update(right);
+
+    return createInner(left, right);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::rotateLeft(Inner* inner) {
+    Inner* pivot = static_cast<Inner*>(mutate(inner->right));
+    Node* tmp = pivot->left;
+
+    ROPE_COUNT(rotations, 1);
+
+    inner->right = tmp;
+    pivot->left = inner;
+
+    update(inner);
+    update(pivot);
+
+    return pivot;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::rotateRight(Inner* inner) {
+    Inner* pivot = static_cast<Inner*>(mutate(inner->left));
+    Node* tmp = pivot->right;
+
+    ROPE_COUNT(rotations, 1);
+
+    inner->left = tmp;
+    pivot->right = inner;
+
+    update(inner);
+    update(pivot);
+
+    return pivot;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::rebalance(Inner* inner) {
+    update(inner);
+
+    int balance = height(inner->left) - height(inner->right);
+
+    if (balance > 1) {
+        Inner* left = static_cast<Inner*>(inner->left);
+
+        if (height(left->left) < height(left->right)) {
+            inner->left = rotateLeft(static_cast<Inner*>(mutate(left)));
+        }
+
+        return rotateRight(inner);
+    }
+
+    if (balance < -1) {
+        Inner* right = static_cast<Inner*>(inner->right);
+
+        if (height(right->right) < height(right->left)) {
+            inner->right = rotateRight(static_cast<Inner*>(mutate(right)));
+        }
+
+        return rotateLeft(inner);
+    }
+
+    return inner;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+std::pair<typename Rope<TData, TDataSize, TSummary, TAllocator>::Inner*, typename Rope<TData, TDataSize, TSummary, TAllocator>::Outer*> Rope<TData, TDataSize, TSummary, TAllocator>::leftmost(Node* node)
+{
+    Inner* inner = nullptr;
+
+    while (node->inner) {
+        inner = static_cast<Inner*>(node);
+        node = inner->left;
+    }
+
+    Outer* outer = static_cast<Outer*>(node);
+    return {inner, outer};
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+std::pair<typename Rope<TData, TDataSize, TSummary, TAllocator>::Inner*, typename Rope<TData, TDataSize, TSummary, TAllocator>::Outer*> Rope<TData, TDataSize, TSummary, TAllocator>::rightmost(Node* node)
+{
+    Inner* inner = nullptr;
+
+    while (node->inner) {
+        inner = static_cast<Inner*>(node);
+        node = inner->right;
+    }
+
+    Outer* outer = static_cast<Outer*>(node);
+    return {inner, outer};
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::popLeftmost(Node* node, Outer*& leaf) {
+    if (!node->inner) {
+        leaf = static_cast<Outer*>(node);
+        return nullptr;
+    }
+
+    Inner* inner = static_cast<Inner*>(mutate(node));
+    Node* left = popLeftmost(inner->left, leaf);
+
+    if (left == nullptr) {
+        Node* right = inner->right;
+        TAllocator::destroy(inner);
+
+        return right;
+    }
+
+    inner->left = left;
+    return rebalance(inner);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::popRightmost(Node* node, Outer*& leaf) {
+    if (!node->inner) {
+        leaf = static_cast<Outer*>(node);
+        return nullptr;
+    }
+
+    Inner* inner = static_cast<Inner*>(mutate(node));
+    Node* right = popRightmost(inner->right, leaf);
+
+    if (right == nullptr) {
+        Node* left = inner->left;
+        TAllocator::destroy(inner);
+
+        return left;
+    }
+
+    inner->right = right;
+    return rebalance(inner);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TDataSize, TSummary, TAllocator>::at(const Node* node, size_t index) {
+    ROPE_COUNT(lookups, 1);
+    ROPE_COUNT(visits, 1);
+
+    while (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+
+        ROPE_COUNT(visits, 1);
+
+        if (index < inner->left->size) {
+            node = inner->left;
+        } else {
+            index -= inner->left->size;
+            node = inner->right;
+        }
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+    return outer->data[index];
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::array(Node* node, TData* array) {
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+
+        Rope::array(inner->left, array);
+        Rope::array(inner->right, array + inner->left->size);
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+        std::copy(outer->data, outer->data + outer->size, array);
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::stats(const Node* node, Stats& result) {
+    result.nodes++;
+    result.shared += node->refs.load(std::memory_order_relaxed) > 1;
+
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+
+        result.used += sizeof(Inner);
+        stats(inner->left, result);
+        stats(inner->right, result);
+    } else {
+        const Outer* outer = static_cast<const Outer*>(node);
+
+        result.leaves++;
+        result.fill[std::min(outer->size * Stats::Buckets / MaxSize, Stats::Buckets - 1)]++;
+
+        if (outer->mapping == nullptr) {
+            result.used += sizeof(Outer) + MaxSize * sizeof(TData);
+        } else {
+            result.used += sizeof(Outer);
+            result.mapped++;
+        }
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::exclusive(const Node* node) {
+    // the subtree of a shared node is reachable through every rope sharing it
+    if (node->refs.load(std::memory_order_acquire) > 1) {
+        return 0;
+    }
+
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        return sizeof(Inner) + exclusive(inner->left) + exclusive(inner->right);
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+
+    return outer->mapping == nullptr
+        ? sizeof(Outer) + MaxSize * sizeof(TData)
+        : sizeof(Outer);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TFunction, typename TExecutor>
+void Rope<TData, TDataSize, TSummary, TAllocator>::parallelForEachChunk(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function, TExecutor& executor) {
+    if (!node->inner) {
+        const Outer* outer = static_cast<const Outer*>(node);
+        size_t first = std::max(begin, offset);
+        size_t last = std::min(end, offset + outer->size);
+
+        function(std::span<const TData>(outer->data + first - offset, last - first), first);
+        return;
+    }
+
+    const Inner* inner = static_cast<const Inner*>(node);
+    size_t middle = offset + inner->left->size;
+
+    if (end <= middle) {
+        parallelForEachChunk(inner->left, offset, begin, end, function, executor);
+    } else if (begin >= middle) {
+        parallelForEachChunk(inner->right, middle, begin, end, function, executor);
+    } else if (end - begin < ParallelSize) {
+        parallelForEachChunk(inner->left, offset, begin, end, function, executor);
+        parallelForEachChunk(inner->right, middle, begin, end, function, executor);
+    } else {
+        executor.invoke(
+            [&] { parallelForEachChunk(inner->left, offset, begin, end, function, executor); },
+            [&] { parallelForEachChunk(inner->right, middle, begin, end, function, executor); });
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TValue, typename TMap, typename TCombine, typename TExecutor>
+TValue Rope<TData, TDataSize, TSummary, TAllocator>::parallelReduce(const Node* node, size_t offset, size_t begin, size_t end, const TValue& identity, TMap& map, TCombine& combine, TExecutor& executor) {
+    if (!node->inner) {
+        const Outer* outer = static_cast<const Outer*>(node);
+        size_t first = std::max(begin, offset);
+        size_t last = std::min(end, offset + outer->size);
+
+        return map(std::span<const TData>(outer->data + first - offset, last - first));
+    }
+
+    const Inner* inner = static_cast<const Inner*>(node);
+    size_t middle = offset + inner->left->size;
+
+    if (end <= middle) {
+        return parallelReduce<TValue>(inner->left, offset, begin, end, identity, map, combine, executor);
+    }
+
+    if (begin >= middle) {
+        return parallelReduce<TValue>(inner->right, middle, begin, end, identity, map, combine, executor);
+    }
+
+    if (end - begin < ParallelSize) {
+        TValue left = parallelReduce<TValue>(inner->left, offset, begin, end, identity, map, combine, executor);
+        return combine(left, parallelReduce<TValue>(inner->right, middle, begin, end, identity, map, combine, executor));
+    }
+
+    // both results start as the identity, so TValue needs no default constructor
+    TValue left = identity;
+    TValue right = identity;
+
+    executor.invoke(
+        [&] { left = parallelReduce<TValue>(inner->left, offset, begin, end, identity, map, combine, executor); },
+        [&] { right = parallelReduce<TValue>(inner->right, middle, begin, end, identity, map, combine, executor); });
+
+    return combine(left, right);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TFunction>
+bool Rope<TData, TDataSize, TSummary, TAllocator>::forEachChunkReverse(const Node* node, size_t offset, size_t begin, size_t end, TFunction& function) {
+    if (node->inner) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        size_t middle = offset + inner->left->size;
+
+        if (end > middle && !forEachChunkReverse(inner->right, middle, begin, end, function)) {
+            return false;
+        }
+
+        return begin >= middle || forEachChunkReverse(inner->left, offset, begin, end, function);
+    }
+
+    const Outer* outer = static_cast<const Outer*>(node);
+    size_t first = std::max(begin, offset);
+    size_t last = std::min(end, offset + outer->size);
+
+    return first >= last || function(std::span<const TData>(outer->data + first - offset, last - first), first);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::build(size_t size, TData* data, size_t count, size_t threads, Mapping* mapping) {
+    if (count == 1) {
+        return mapping == nullptr
+            ? createOuter(size, data)
+            : createMapped(size, data, mapping);
+    }
+
+    // spread the data evenly, so every leaf holds at least half of MaxSize
+    size_t leftCount = count / 2;
+    size_t leftSize = size / count * leftCount + std::min(size % count, leftCount);
+
+    if (threads > 1 && size >= ParallelSize) {
+        Node* left;
+        std::thread thread([&] {
+            left = build(leftSize, data, leftCount, threads / 2, mapping);
+        });
+
+        Node* right = build(size - leftSize, data + leftSize, count - leftCount, threads - threads / 2, mapping);
+        thread.join();
+
+        return createInner(left, right);
+    }
+
+    Node* left = build(leftSize, data, leftCount, 1, mapping);
+    Node* right = build(size - leftSize, data + leftSize, count - leftCount, 1, mapping);
+
+    return createInner(left, right);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::concat(Node* left, Node* right) {
+    if (left == nullptr) {
+        return right;
+    }
+
+    if (right == nullptr) {
+        return left;
+    }
+
+    if (left->height > right->height + 1) {
+        Inner* inner = static_cast<Inner*>(mutate(left));
+        inner->right = concat(inner->right, right);
+
+        return rebalance(inner);
+    }
+
+    if (right->height > left->height + 1) {
+        Inner* inner = static_cast<Inner*>(mutate(right));
+        inner->left = concat(left, inner->left);
+
+        return rebalance(inner);
+    }
+
+    return createInner(left, right);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::join(Node* left, Node* right) {
+    if (left == nullptr || left->size == 0) {
+        release(left);
+        return right;
+    }
+
+    if (right == nullptr || right->size == 0) {
+        release(right);
+        return left;
+    }
+
+    Outer* leftLeaf = rightmost(left).second;
+    Outer* rightLeaf = leftmost(right).second;
+
+    if (leftLeaf->size >= MinSize && rightLeaf->size >= MinSize) {
+        return concat(left, right);
+    }
+
+    left = popRightmost(left, leftLeaf);
+    right = popLeftmost(right, rightLeaf);
+
+    return concat(concat(left, combine(leftLeaf, rightLeaf)), right);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+std::pair<typename Rope<TData, TDataSize, TSummary, TAllocator>::Node*, typename Rope<TData, TDataSize, TSummary, TAllocator>::Node*> Rope<TData, TDataSize, TSummary, TAllocator>::split(Node* node, size_t index) {
+    if (node == nullptr) {
+        return {nullptr, nullptr};
+    }
+
+    if (node->inner) {
+        Inner* inner = static_cast<Inner*>(mutate(node));
+        Node* left = inner->left;
+        Node* right = inner->right;
+
+        TAllocator::destroy(inner);
+
+        if (index < left->size) {
+            auto [first, second] = split(left, index);
+            return {first, join(second, right)};
+        }
+
+        if (index > left->size) {
+            auto [first, second] = split(right, index - left->size);
+            return {join(left, first), second};
+        }
+
+        return {left, right};
+    } else {
+        Outer* outer = static_cast<Outer*>(node);
+
+        if (index == 0) {
+            return {nullptr, outer};
+        }
+
+        if (index >= outer->size) {
+            return {outer, nullptr};
+        }
+
+        Outer* right = slice(outer, index, outer->size);
+
+        ROPE_COUNT(splits, 1);
+
+        if (outer->refs.load(std::memory_order_acquire) == 1) {
+            outer->size = index;
+            update(outer);
+
+            return {outer, right};
+        }
+
+        Outer* left = slice(outer, 0, index);
+        release(outer);
+
+        return {left, right};
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::apply(Node* node, size_t offset, size_t before, size_t after, std::span<const Edit> edits) {
+    if (edits.empty()) {
+        return node;
+    }
+
+    // the edits keep their indices in the rope, a node covers the indices from offset to offset plus its size
+    // an edit across the end of the node only removes its tail, its insertion belongs to the node holding its end
+    size_t limit = offset + node->size;
+
+    // for UTF-8 text, before and after count the continuation bytes next to the node, at most three each,
+    // so both ends of an edit are aligned from the untouched data on the way down
+    auto align = [node, offset, limit, before, after](size_t index) {
+        if constexpr (Utf8) {
+            auto continuation = [&](size_t position) {
+                if (position < offset) {
+                    return offset - position <= before;
+                }
+
+                if (position >= limit) {
+                    return position - limit < after;
+                }
+
+                return (static_cast<uint8_t>(at(node, position - offset)) & 0xC0) == 0x80;
+            };
+
+            for (size_t i = 0; i < 3 && index > 0 && continuation(index); i++) {
+                index--;
+            }
+        }
+
+        return index;
+    };
+
+    auto begin = [&align, offset](const Edit& edit) {
+        return std::max(align(edit.index), offset) - offset;
+    };
+
+    auto end = [&align, offset, limit](const Edit& edit) {
+        return std::min(align(edit.index + edit.remove), limit) - offset;
+    };
+
+    auto insert = [&align, limit](const Edit& edit) {
+        return align(edit.index + edit.remove) <= limit
+            ? edit.insert
+            : std::span<const TData>();
+    };
+
+    // the replacement leaves are filled one after another, which also works for data that is not trivially copyable
+    Node* result = nullptr;
+    Outer* leaf = nullptr;
+
+    auto append = [&result, &leaf](const TData* data, size_t size) {
+        while (size > 0) {
+            if (leaf == nullptr || leaf->size == MaxSize) {
+                if (leaf != nullptr) {
+                    update(leaf);
+                    result = join(result, leaf);
+                }
+
+                leaf = createEmpty();
+            }
+
+            size_t count = std::min(size, MaxSize - leaf->size);
+
+            std::copy(data, data + count, leaf->data + leaf->size);
+            leaf->size += count;
+
+            data += count;
+            size -= count;
+        }
+    };
+
+    auto finish = [&result, &leaf] {
+        if (leaf != nullptr) {
+            update(leaf);
+            result = join(result, leaf);
+        }
+
+        return result;
+    };
+
+    if (node->inner) {
+        // a subtree covered by a single edit is released whole
+        if (edits.size() == 1 && begin(edits.front()) == 0 && end(edits.front()) == node->size) {
+            std::span<const TData> added = insert(edits.front());
+
+            append(added.data(), added.size());
+            release(node);
+
+            return finish();
+        }
+
+        Inner* inner = static_cast<Inner*>(mutate(node));
+        Node* left = inner->left;
+        Node* right = inner->right;
+        size_t middle = offset + left->size;
+
+        auto split = std::partition_point(edits.begin(), edits.end(), [&align, middle](const Edit& edit) {
+            return align(edit.index) < middle;
+        });
+
+        // the last edit of the left child may reach into the right child
+        size_t leftCount = split - edits.begin();
+        size_t rightStart = leftCount > 0 && align(edits[leftCount - 1].index + edits[leftCount - 1].remove) > middle
+            ? leftCount - 1
+            : leftCount;
+
+        size_t leftAfter = 0;
+        size_t rightBefore = 0;
+
+        if constexpr (Utf8) {
+            leftAfter = leading(right, after);
+            rightBefore = trailing(left, before);
+        }
+
+        TAllocator::destroy(inner);
+
+        return join(apply(left, offset, before, leftAfter, edits.first(leftCount)), apply(right, middle, rightBefore, after, edits.subspan(rightStart)));
+    }
+
+    Outer* outer = static_cast<Outer*>(node);
+    size_t inserted = 0;
+
+    for (const Edit& edit : edits) {
+        inserted += insert(edit).size();
+    }
+
+    if (outer->size + inserted <= MaxSize && outer->refs.load(std::memory_order_acquire) == 1 && outer->mapping == nullptr) {
+        // edit the leaf in place from the back, so the earlier indices stay valid,
+        // the ends of every edit are taken before the later edit changes the data they are aligned on
+        size_t first = begin(edits.back());
+        size_t last = end(edits.back());
+        std::span<const TData> added = insert(edits.back());
+
+        for (size_t i = edits.size(); i-- > 0;) {
+            TData* data = outer->data;
+            size_t moved = first + added.size();
+            size_t nextFirst = i > 0 ? begin(edits[i - 1]) : 0;
+            size_t nextLast = i > 0 ? end(edits[i - 1]) : 0;
+            std::span<const TData> nextAdded = i > 0 ? insert(edits[i - 1]) : std::span<const TData>();
+
+            if (moved > last) {
+                std::copy_backward(data + last, data + outer->size, data + outer->size + moved - last);
+            } else {
+                std::copy(data + last, data + outer->size, data + moved);
+            }
+
+            std::copy(added.begin(), added.end(), data + first);
+            outer->size = outer->size + moved - last;
+
+            first = nextFirst;
+            last = nextLast;
+            added = nextAdded;
+        }
+
+        update(outer);
+        return outer;
+    }
+
+    size_t index = 0;
+
+    for (const Edit& edit : edits) {
+        std::span<const TData> added = insert(edit);
+
+        append(outer->data + index, begin(edit) - index);
+        append(added.data(), added.size());
+
+        index = end(edit);
+    }
+
+    append(outer->data + index, outer->size - index);
+    release(outer);
+
+    return finish();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::leading(const Node* node, size_t after) {
+    size_t count = 0;
+
+    while (count < 3 && count < node->size && (static_cast<uint8_t>(at(node, count)) & 0xC0) == 0x80) {
+        count++;
+    }
+
+    return count == node->size ? std::min<size_t>(count + after, 3) : count;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::trailing(const Node* node, size_t before) {
+    size_t count = 0;
+
+    while (count < 3 && count < node->size && (static_cast<uint8_t>(at(node, node->size - count - 1)) & 0xC0) == 0x80) {
+        count++;
+    }
+
+    return count == node->size ? std::min<size_t>(count + before, 3) : count;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+int Rope<TData, TDataSize, TSummary, TAllocator>::height(Node* node) {
+    return node->height;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::Iterator()
+    : root(nullptr)
+    , depth(0)
+    , offset(0)
+    , first(nullptr)
+    , last(nullptr)
+    , current(nullptr)
+{
+    // empty
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::Iterator(Node** root, size_t index)
+    : root(root)
+{
+    seek(index);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+TOther& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator*() const {
+    return *current;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+TOther* Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator->() const {
+    return current;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+TOther& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator[](difference_type distance) const {
+    return *(*this + distance);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator++() {
+    if (++current == last) {
+        next();
+    }
+
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther> Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator++(int) {
+    Iterator<TOther> result = *this;
+    ++*this;
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator--() {
+    if (current == first) {
+        previous();
+    }
+
+    --current;
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther> Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator--(int) {
+    Iterator<TOther> result = *this;
+    --*this;
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator+=(difference_type distance) {
+    if (distance >= first - current && distance < last - current) {
+        current += distance;
     } else {
-        Outer* outer = static_cast<Outer*>(node);
-        std::copy(outer->data, outer->data + outer->size, array);
+        seek(index() + distance);
     }
+
+    return *this;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>& Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator-=(difference_type distance) {
+    return *this += -distance;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther> Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator+(difference_type distance) const {
+    Iterator<TOther> result = *this;
+    result += distance;
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther> Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator-(difference_type distance) const {
+    Iterator<TOther> result = *this;
+    result -= distance;
+
+    return result;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::difference_type Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator-(const Iterator<TOther>& other) const {
+    return difference_type(index()) - difference_type(other.index());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+bool Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator==(const Iterator<TOther>& other) const {
+    // every index has exactly one position, so the pointers are unique
+    return current == other.current;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+std::strong_ordering Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::operator<=>(const Iterator<TOther>& other) const {
+    return index() <=> other.index();
 }
 
-template <typename TData, size_t TDataSize>
-Rope<TData, TDataSize>::Node* Rope<TData, TDataSize>::append(Node* left, Node* right) {
-    if (left->inner && right->inner) {
-        Inner* inner = createInner(left, right);
-        return inner;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::seek(size_t index) {
+    if constexpr (Mutable) {
+        *root = mutate(*root);
     }
 
-    if (left->inner) {
-        Outer* outer = static_cast<Outer*>(right);
-        auto [parent, right] = rightmost(left);
-        size_t total = outer->size + right->size;
-        
-        TData* outerBegin = outer->data;
-        TData* outerEnd = outerBegin + outer->size;
-        TData* rightBegin = right->data;
-        TData* rightEnd = rightBegin + right->size;
+    path[0] = *root;
+    depth = 0;
+    offset = 0;
 
-        if (total <= MaxSize) {
-            std::copy(outerBegin, outerEnd, rightEnd);
-            right->size = total;
+    descend(index);
+}
 
-            destroy(outer);
-        } else {
-            size_t size = MinSize - outer->size;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::index() const {
+    return offset + (current - first);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+std::span<TOther> Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::chunk() const {
+    return std::span<TOther>(current, last);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::nextChunk() {
+    current = last;
+    next();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::descend(size_t index) {
+    Node* node = path[depth];
 
-            std::copy(outerBegin, outerEnd, outerBegin + size);
-            std::copy(rightEnd - size, rightEnd, outerBegin);
+    while (node->inner) {
+        Inner* inner = static_cast<Inner*>(node);
+        Node** child = &inner->left;
 
-            outer->size = MinSize;
-            right->size -= size;
+        if (index >= inner->left->size) {
+            index -= inner->left->size;
+            offset += inner->left->size;
+            child = &inner->right;
         }
 
-        Node* inner = createInner(right, outer);
-        parent->right = inner;
+        if constexpr (Mutable) {
+            *child = mutate(*child);
+        }
 
-        return left;
+        node = *child;
+        path[++depth] = node;
     }
 
-    if (right->inner) {
-        Outer* outer = static_cast<Outer*>(left);
-        auto [parent, left] = leftmost(right);
-        size_t total = outer->size + left->size;
-        
-        TData* outerBegin = outer->data;
-        TData* outerEnd = outerBegin + outer->size;
-        TData* leftBegin = left->data;
-        TData* leftEnd = leftBegin + left->size;
-
-        if (total <= MaxSize) {
-            std::copy(leftBegin, leftEnd, leftBegin + outer->size);
-            std::copy(outerBegin, outerEnd, leftBegin);
-            
-            left->size = total;
-            destroy(outer);
-        } else {
-            size_t size = MinSize - outer->size;
+    Outer* outer = static_cast<Outer*>(node);
+
+    first = outer->data;
+    last = first + outer->size;
+    current = first + index;
+}
 
-            std::copy(leftBegin, leftEnd - size, outerEnd);
-            std::copy(leftBegin + size, leftEnd, leftBegin);
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::next() {
+    for (size_t i = depth; i-- > 0;) {
+        Inner* inner = static_cast<Inner*>(path[i]);
 
-            outer->size = MinSize;
-            right->size -= size;
+        if (inner->left == path[i + 1]) {
+            if constexpr (Mutable) {
+                inner->right = mutate(inner->right);
+            }
+
+            offset += last - first;
+            depth = i + 1;
+            path[depth] = inner->right;
+
+            descend(0);
+            return;
         }
+    }
+}
 
-        Node* inner = createInner(left, outer);
-        parent->left = inner;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+template <typename TOther>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Iterator<TOther>::previous() {
+    for (size_t i = depth; i-- > 0;) {
+        Inner* inner = static_cast<Inner*>(path[i]);
 
-        return right;
+        if (inner->right == path[i + 1]) {
+            if constexpr (Mutable) {
+                inner->left = mutate(inner->left);
+            }
+
+            offset -= inner->left->size;
+            depth = i + 1;
+            path[depth] = inner->left;
+
+            descend(inner->left->size);
+            return;
+        }
     }
+}
 
-    return nullptr;
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Builder::Builder()
+    : levels(), leaf(nullptr), filled(0)
+{
+    static_assert(std::is_trivially_copyable_v<TData>, "only trivially copyable data can be read");
 }
 
-template <typename TData, size_t TDataSize>
-size_t Rope<TData, TDataSize>::size(Node* node) {
-    if (node->inner) {
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Builder::~Builder() {
+    for (Node* level : levels) {
+        release(level);
+    }
+
+    release(leaf);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Builder::append(const TData* data, size_t size) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    size_t total = size * sizeof(TData);
+
+    while (total > 0) {
+        Outer* current = fresh();
+        size_t count = std::min(total, MaxBytes - filled);
+
+        std::copy(bytes, bytes + count, reinterpret_cast<char*>(current->data) + filled);
+        fill(count);
+
+        bytes += count;
+        total -= count;
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Builder::read(int fd) {
+    Outer* spares[ReadBatch];
+    iovec batch[ReadBatch];
+    size_t spare = 0;
+
+    auto clear = [&] {
+        for (size_t i = 0; i < spare; i++) {
+            release(spares[i]);
+        }
+    };
+
+    while (true) {
+        Outer* current = fresh();
+
+        batch[0] = {reinterpret_cast<char*>(current->data) + filled, MaxBytes - filled};
+
+        for (; spare < ReadBatch - 1; spare++) {
+            spares[spare] = createEmpty();
+        }
+
+        for (size_t i = 0; i < spare; i++) {
+            batch[i + 1] = {spares[i]->data, MaxBytes};
+        }
+
+        ssize_t result = ::readv(fd, batch, spare + 1);
+
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (result < 0) {
+            int error = errno;
+            clear();
+
+            throw std::system_error(error, std::generic_category(), "readv");
+        }
+
+        if (result == 0) {
+            clear();
+            return;
+        }
+
+        // hand the read bytes to the current leaf and then to the spare leaves in order
+        size_t bytes = result;
+        size_t used = 0;
+
+        while (bytes > 0) {
+            if (leaf == nullptr) {
+                leaf = spares[used++];
+            }
+
+            size_t count = std::min(bytes, MaxBytes - filled);
+
+            fill(count);
+            bytes -= count;
+        }
+
+        std::copy(spares + used, spares + spare, spares);
+        spare -= used;
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Builder::read(std::istream& is) {
+    while (is) {
+        Outer* current = fresh();
+
+        is.read(reinterpret_cast<char*>(current->data) + filled, MaxBytes - filled);
+        fill(is.gcount());
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator> Rope<TData, TDataSize, TSummary, TAllocator>::Builder::build() {
+    return TRope(finish());
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Node* Rope<TData, TDataSize, TSummary, TAllocator>::Builder::finish() {
+    Node* root = nullptr;
+
+    // the lower levels hold the later data
+    for (Node*& level : levels) {
+        if (level != nullptr) {
+            root = root == nullptr ? level : concat(level, root);
+            level = nullptr;
+        }
+    }
+
+    if (leaf != nullptr) {
+        update(leaf);
+        root = join(root, leaf);
+
+        leaf = nullptr;
+        filled = 0;
+    }
+
+    if (root != nullptr && root->size == 0) {
+        release(root);
+        root = nullptr;
+    }
+
+    return root;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::Builder::fresh() {
+    if (leaf == nullptr) {
+        leaf = createEmpty();
+        filled = 0;
+    }
+
+    return leaf;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Builder::fill(size_t bytes) {
+    filled += bytes;
+    leaf->size = filled / sizeof(TData);
+
+    if (filled == MaxBytes) {
+        push();
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Builder::push() {
+    Node* node = leaf;
+    size_t level = 0;
+
+    update(leaf);
+
+    for (; levels[level] != nullptr; level++) {
+        node = createInner(levels[level], node);
+        levels[level] = nullptr;
+    }
+
+    levels[level] = node;
+    leaf = nullptr;
+    filled = 0;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::Cursor(TRope& rope, size_t index)
+    : rope(&rope), position(std::min(index, rope.size()))
+{
+    descend(false);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+size_t Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::index() const {
+    return position;
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::seek(size_t index) {
+    position = std::min(index, rope->size());
+
+    if (position < offset || position > offset + leaf()->size) {
+        descend(false);
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+const TData& Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::get() {
+    assert(position < rope->size());
+
+    if (position - offset >= leaf()->size) {
+        descend(false);
+    }
+
+    return leaf()->data[position - offset];
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::insert(const TData* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    if constexpr (Utf8) {
+        seek(rope->align(position));
+    }
+
+    Outer* outer = prepare();
+    size_t capacity = outer == &rope->local ? InlineSize : MaxSize;
+    size_t index = position - offset;
+
+    if (outer->size + size > capacity) {
+        // the position is aligned already, so the rope inserts exactly at it
+        rope->insert(TRope(size, const_cast<TData*>(data)), position);
+        position += size;
+
+        descend(false);
+        return;
+    }
+
+    std::copy_backward(outer->data + index, outer->data + outer->size, outer->data + outer->size + size);
+    std::copy(data, data + size, outer->data + index);
+
+    outer->size += size;
+    position += size;
+
+    update(outer);
+    propagate();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::insert(const TData& value) {
+    insert(&value, 1);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::remove(size_t count) {
+    size_t end = position + std::min(count, rope->size() - position);
+
+    if constexpr (Utf8) {
+        seek(rope->align(position));
+        end = rope->align(end);
+    }
+
+    if (end <= position) {
+        return;
+    }
+
+    count = end - position;
+
+    Outer* outer = prepare();
+    size_t index = position - offset;
+
+    // a leaf that is not the root must keep MinSize data, a root leaf that fits inline moves there
+    if (index + count > outer->size
+        || (depth > 0 && outer->size - count < MinSize)
+        || (depth == 0 && outer != &rope->local && outer->size - count <= InlineSize)) {
+        rope->remove(position, position + count);
+
+        descend(false);
+        return;
+    }
+
+    std::copy(outer->data + index + count, outer->data + outer->size, outer->data + index);
+    outer->size -= count;
+
+    update(outer);
+    propagate();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::leaf() const {
+    return static_cast<Outer*>(path[depth]);
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::descend(bool write) {
+    Node** slot = &rope->root;
+    size_t index = position;
+
+    depth = 0;
+    offset = 0;
+
+    while (true) {
+        if (write) {
+            *slot = mutate(*slot);
+        }
+
+        Node* node = *slot;
+        path[depth] = node;
+
+        if (!node->inner) {
+            return;
+        }
+
         Inner* inner = static_cast<Inner*>(node);
-        return inner->size + size(inner->right);
-    } else {
-        Outer* outer = static_cast<Outer*>(node);
-        return outer->size;
+
+        if (index < inner->left->size) {
+            slot = &inner->left;
+        } else {
+            index -= inner->left->size;
+            offset += inner->left->size;
+            slot = &inner->right;
+        }
+
+        depth++;
+    }
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+Rope<TData, TDataSize, TSummary, TAllocator>::Outer* Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::prepare() {
+    // the path is only copied if a copy of the rope shares it or the leaf is mapped
+    bool writable = path[0] == rope->root && leaf()->mapping == nullptr;
+
+    for (size_t i = 0; writable && i <= depth; i++) {
+        writable = path[i]->refs.load(std::memory_order_acquire) == 1;
+    }
+
+    if (!writable) {
+        descend(true);
+    }
+
+    return leaf();
+}
+
+template <typename TData, size_t TDataSize, typename TSummary, typename TAllocator>
+void Rope<TData, TDataSize, TSummary, TAllocator>::Cursor::propagate() {
+    for (size_t i = depth; i-- > 0;) {
+        update(static_cast<Inner*>(path[i]));
     }
 }
 
-} // namespace Rope
\ No newline at end of file
+} // namespace Rope
@@ -1,7 +1,25 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <cstring>
+#include <iostream>
+#include <random>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
-// #include "../source/rope.hpp"
+// the tests are a single translation unit, so the counters are enabled for the whole program, see ROPE_COUNT
+#define ROPE_COUNTERS
+
+#include "../source/btree.hpp"
+#include "../source/concurrent.hpp"
+#include "../source/history.hpp"
+#include "../source/rope.hpp"
 #include "../source/tree.hpp"
 
 #define ASSERT_SIZE(actual, expected) assert(actual.size() == expected)
@@ -12,7 +30,7 @@
     assert(oss.str() == expected); \
 }
 
-/*char* heap(const char* str) {
+char* heap(const char* str) {
     size_t size = strlen(str);
     char* res = new char[size];
 
@@ -49,10 +67,18 @@ void testMove() {
 
     ASSERT_SIZE(rope, 5);
     ASSERT_DATA(rope, "hello");
-    
-    str[1] = 'a';
 
-    ASSERT_DATA(rope, "hallo");
+    // the leaves reference a large array instead of copying it
+    std::string expected(5000, 'm');
+    char* large = heap(expected.c_str());
+    auto adopted = Util::Rope<char>::move(expected.size(), large);
+
+    assert(&*adopted.begin() == large);
+    assert(adopted.stats().mapped > 0);
+
+    adopted.erase(0, 1);
+    expected.erase(0, 1);
+    ASSERT_DATA(adopted, expected);
 }
 
 void testAppend() {
@@ -86,18 +112,1700 @@ void testSplit() {
     ASSERT_DATA(right, " world");
 }
 
-int main(int argc, char** argv) {
-    testEmpty();
-    testCopy();
-    testMove();
-    testAppend();
-    testSplit();
+void testInsert() {
+    auto rope = Util::Rope<char>::move(11, heap("hello world"));
+    rope.insert(5, Util::Rope<char>::move(4, heap(" big")));
 
-    std::cout << "All tests completed!" << std::endl;
-    return 0;
-}*/
+    ASSERT_SIZE(rope, 15);
+    ASSERT_DATA(rope, "hello big world");
+
+    rope.erase(0, 6);
+
+    ASSERT_DATA(rope, "big world");
+    assert(rope[4] == 'w');
+}
+
+void testIterator() {
+    std::string expected;
+    auto rope = Util::Rope<char>::empty();
+
+    for (int i = 0; i < 1000; i++) {
+        std::string str = std::to_string(i);
+
+        expected += str;
+        rope.append(Util::Rope<char>::copy(str.size(), str.data()));
+    }
+
+    std::string actual;
+
+    for (char c : rope) {
+        actual += c;
+    }
+
+    assert(actual == expected);
+    ASSERT_DATA(rope, expected);
+
+    size_t digits = 0;
+
+    rope.forEachChunk(0, rope.size(), [&](std::span<const char> chunk) {
+        digits += std::count_if(chunk.begin(), chunk.end(), isdigit);
+    });
+
+    assert(digits == expected.size());
+
+    std::string needle = "999";
+
+    assert(rope.find('9') == expected.find('9'));
+    assert(rope.rfind('0') == expected.rfind('0'));
+    assert(rope.count('1') == size_t(std::count(expected.begin(), expected.end(), '1')));
+    assert(rope.find(std::span<const char>(needle)) == expected.find(needle));
+    assert(rope.rfind(std::span<const char>(needle), 100) == expected.rfind(needle, 100));
+}
+
+template <typename TRope>
+std::string text(const TRope& rope) {
+    char* data = rope.array();
+    std::string result(data, rope.size());
+
+    delete[] data;
+    return result;
+}
+
+template <typename TRope>
+TRope make(const char* str) {
+    return TRope(strlen(str), const_cast<char*>(str));
+}
+
+#define ASSERT_TEXT(actual, expected) assert(text(actual) == expected)
+
+typedef Rope::Rope<char> Tree;
+typedef Rope::Rope<char, 8, Rope::Summary::None, Rope::HeapAllocator> SmallTree;
+
+void testTreeEmpty() {
+    Tree tree;
+
+    ASSERT_SIZE(tree, 0);
+    ASSERT_TEXT(tree, "");
+}
+
+void testTreeAppend() {
+    auto tree = make<Tree>("hello");
+    auto other = make<Tree>(" world");
+
+    tree.append(std::move(other));
+
+    ASSERT_SIZE(tree, 11);
+    ASSERT_SIZE(other, 0);
+    ASSERT_TEXT(tree, "hello world");
+}
+
+void testTreeSplit() {
+    auto tree = make<SmallTree>("hello");
+    tree.append(make<SmallTree>(" world"));
+
+    auto [left, right] = tree.split(5);
+
+    ASSERT_SIZE(tree, 0);
+    ASSERT_TEXT(left, "hello");
+    ASSERT_TEXT(right, " world");
+}
+
+void testTreeInsert() {
+    auto tree = make<SmallTree>("hello world");
+    tree.insert(make<SmallTree>(" big"), 5);
+
+    ASSERT_SIZE(tree, 15);
+    ASSERT_TEXT(tree, "hello big world");
+    assert(tree[6] == 'b');
+}
+
+void testTreeRemove() {
+    auto tree = make<SmallTree>("hello big world");
+    tree.remove(5, 9);
+
+    ASSERT_TEXT(tree, "hello world");
+
+    tree.remove(0, tree.size());
+    ASSERT_TEXT(tree, "");
+}
+
+void testTreeCopy() {
+    auto tree = make<SmallTree>("hello world");
+    SmallTree copy = tree;
+
+    copy.remove(0, 6);
+
+    ASSERT_TEXT(tree, "hello world");
+    ASSERT_TEXT(copy, "world");
+}
+
+void testTreeShare() {
+    auto tree = make<SmallTree>("hello world, hello rope");
+    const SmallTree snapshot = tree;
+
+    tree[0] = 'j';
+    tree.insert(make<SmallTree>("big "), 6);
+
+    SmallTree other = tree;
+    auto [left, right] = other.split(10);
+
+    left.remove(0, 2);
+    right.append(make<SmallTree>("!"));
+
+    std::fill(right.mutableBegin(), right.mutableEnd(), 'x');
+
+    ASSERT_TEXT(snapshot, "hello world, hello rope");
+    ASSERT_TEXT(tree, "jello big world, hello rope");
+    ASSERT_TEXT(left, "llo big ");
+    ASSERT_TEXT(right, "xxxxxxxxxxxxxxxxxx");
+    assert(snapshot[0] == 'h');
+
+    // reading a copy through a non-const reference leaves its nodes shared
+    SmallTree reader = tree;
+    size_t sum = 0;
+
+    for (size_t i = 0; i < reader.size(); i++) {
+        sum += reader[i] + reader.at(i);
+    }
+
+    for (char c : reader) {
+        sum += c;
+    }
+
+    assert(sum > 0 && reader.exclusive() == 0);
+}
+
+void testTreeIterator() {
+    static_assert(std::random_access_iterator<SmallTree::Iter>);
+    static_assert(std::random_access_iterator<SmallTree::ConstIter>);
+
+    std::string expected;
+    SmallTree tree;
+
+    for (int i = 0; i < 500; i++) {
+        std::string str = std::to_string(i);
+
+        expected += str;
+        tree.append(make<SmallTree>(str.c_str()));
+    }
+
+    const SmallTree& view = tree;
+    auto begin = view.begin();
+    auto end = view.end();
+
+    assert(end - begin == ptrdiff_t(expected.size()));
+    assert(std::string(begin, end) == expected);
+    assert(std::string(std::make_reverse_iterator(end), std::make_reverse_iterator(begin))
+        == std::string(expected.rbegin(), expected.rend()));
+
+    for (size_t i = 0; i < expected.size(); i += 37) {
+        auto it = begin + i;
+
+        assert(*it == expected[i]);
+        assert(it.index() == i);
+        assert(begin[i] == expected[i]);
+        assert((it += 5) - begin == ptrdiff_t(i + 5));
+        assert(it[-5] == expected[i]);
+        assert(--it < end && it > begin);
+    }
+
+    auto it = begin;
+    it.seek(expected.size());
+    assert(it == end);
+
+    SmallTree snapshot = tree;
+    std::fill(tree.mutableBegin() + 10, tree.mutableEnd(), '-');
+
+    ASSERT_TEXT(snapshot, expected);
+    ASSERT_TEXT(tree, expected.substr(0, 10) + std::string(expected.size() - 10, '-'));
+}
+
+void testTreeChunks() {
+    std::string expected;
+    SmallTree tree;
+
+    for (int i = 0; i < 200; i++) {
+        std::string str = std::to_string(i);
+
+        expected += str;
+        tree.append(make<SmallTree>(str.c_str()));
+    }
+
+    for (size_t begin = 0; begin < expected.size(); begin += 41) {
+        size_t end = std::min(begin + 97, expected.size());
+        std::string actual;
+
+        bool completed = tree.forEachChunk(begin, end, [&](std::span<const char> chunk) {
+            assert(chunk.size() > 0 && chunk.size() <= 8);
+            actual.append(chunk.begin(), chunk.end());
+        });
+
+        assert(completed);
+        assert(actual == expected.substr(begin, end - begin));
+    }
+
+    size_t visited = 0;
+
+    bool completed = tree.forEachChunk(0, tree.size(), [&](std::span<const char> chunk) {
+        visited += chunk.size();
+        return visited < 20;
+    });
+
+    assert(!completed);
+    assert(visited >= 20 && visited < 28);
+}
+
+void testTreeSearch() {
+    std::mt19937 random(7);
+    std::string expected;
+    SmallTree tree;
+
+    for (int i = 0; i < 3000; i++) {
+        char c = 'a' + random() % 4;
+
+        expected += c;
+        tree.append(SmallTree(1, &c));
+    }
+
+    for (char c : std::string("abcdx")) {
+        assert(tree.count(c) == size_t(std::count(expected.begin(), expected.end(), c)));
+        assert(tree.count(c, 100, 2000) == size_t(std::count(expected.begin() + 100, expected.begin() + 2000, c)));
+
+        for (size_t index : {size_t(0), size_t(1), size_t(777), size_t(2999), size_t(5000)}) {
+            assert(tree.find(c, index) == expected.find(c, index));
+            assert(tree.rfind(c, index) == expected.rfind(c, index));
+        }
+    }
+
+    for (int i = 0; i < 200; i++) {
+        size_t length = 1 + random() % 12;
+        size_t start = random() % (expected.size() - length);
+        std::string needle = i % 2 ? expected.substr(start, length) : std::string(length, 'a' + random() % 4);
+        size_t index = random() % expected.size();
+
+        assert(tree.find(std::span<const char>(needle), index) == expected.find(needle, index));
+        assert(tree.rfind(std::span<const char>(needle), index) == expected.rfind(needle, index));
+    }
+
+    assert(tree.find(std::span<const char>("abcdabcdabcdabcd", 16)) == SmallTree::NotFound);
+    assert(SmallTree().rfind('a') == SmallTree::NotFound);
+}
+
+void testSearchKernels() {
+    std::string data(1000, 'a');
+
+    for (size_t i = 0; i < data.size(); i += 97) {
+        data[i] = 'b';
+    }
+
+    for (size_t begin : {0, 3, 31, 64}) {
+        for (size_t end : {64, 65, 100, 999, 1000}) {
+            const char* first = data.data() + begin;
+            const char* last = data.data() + end;
+
+            assert(Rope::Search::find(first, last, 'b') == std::find(first, last, 'b'));
+            assert(Rope::Search::count(first, last, 'b') == size_t(std::count(first, last, 'b')));
+            assert(Rope::Search::count(first, last, 'a') == size_t(std::count(first, last, 'a')));
+
+            auto reverse = std::find(std::make_reverse_iterator(last), std::make_reverse_iterator(first), 'b');
+            const char* expected = reverse.base() == first ? last : reverse.base() - 1;
+
+            assert(Rope::Search::rfind(first, last, 'b') == expected);
+        }
+    }
+
+    uint64_t sizes[] = {3, 7, 7, 20, 41, 50, 64, INT64_MAX, INT64_MAX};
+
+    for (uint64_t value : {0, 3, 6, 7, 8, 49, 50, 1000}) {
+        size_t expected = std::upper_bound(std::begin(sizes), std::end(sizes), value) - std::begin(sizes);
+        assert(Rope::Search::rank(std::begin(sizes), std::end(sizes), value) == expected);
+    }
+
+    std::mt19937 random(9);
+    std::vector<uint8_t> bytes(20000);
+
+    for (uint8_t& byte : bytes) {
+        byte = random();
+    }
+
+    for (int8_t value : {-128, -65, -17, -1, 0, 127}) {
+        for (size_t begin : {0, 5}) {
+            const uint8_t* first = bytes.data() + begin;
+            const uint8_t* last = bytes.data() + bytes.size() - begin;
+            size_t expected = std::count_if(first, last, [value](uint8_t byte) {
+                return int8_t(byte) > value;
+            });
+
+            assert(Rope::Search::countGreater(first, last, value) == expected);
+        }
+    }
+}
+
+/// Sums the data
+struct Sum {
+    typedef long Value;
+
+    static Value identity() {
+        return 0;
+    }
+
+    static Value combine(Value left, Value right) {
+        return left + right;
+    }
+
+    static Value summarize(std::span<const int> data) {
+        return std::accumulate(data.begin(), data.end(), 0L);
+    }
+};
+
+void testTreeSummary() {
+    typedef Rope::Summary::Tuple<Sum, Rope::Summary::Max<int>> Summary;
+    typedef Rope::Rope<int, 8, Summary, Rope::HeapAllocator> SummaryTree;
+
+    static_assert(std::is_same_v<SummaryTree::Iter, SummaryTree::ConstIter>);
+
+    std::mt19937 random(3);
+    std::vector<int> expected;
+    SummaryTree tree;
+
+    auto sum = [](const SummaryTree::Value& value) {
+        return Rope::Summary::get<Sum, Summary>(value);
+    };
+
+    auto max = [](const SummaryTree::Value& value) {
+        return Rope::Summary::get<Rope::Summary::Max<int>, Summary>(value);
+    };
+
+    for (int i = 0; i < 1000; i++) {
+        size_t index = random() % (expected.size() + 1);
+
+        switch (random() % 3) {
+        case 0: {
+            std::vector<int> values(random() % 20);
+
+            for (int& value : values) {
+                value = random() % 100;
+            }
+
+            expected.insert(expected.begin() + index, values.begin(), values.end());
+            tree.insert(SummaryTree(values.size(), values.data()), index);
+            break;
+        }
+        case 1: {
+            size_t end = std::min(index + random() % 30, expected.size());
+
+            expected.erase(expected.begin() + index, expected.begin() + end);
+            tree.remove(index, end);
+            break;
+        }
+        case 2:
+            if (index < expected.size()) {
+                expected[index] = random() % 1000;
+                tree.set(index, expected[index]);
+            }
+            break;
+        }
+
+        size_t begin = random() % (expected.size() + 1);
+        size_t end = begin + random() % (expected.size() - begin + 1);
+        SummaryTree::Value value = tree.summarize(begin, end);
+
+        assert(sum(tree.summary()) == std::accumulate(expected.begin(), expected.end(), 0L));
+        assert(sum(value) == std::accumulate(expected.begin() + begin, expected.begin() + end, 0L));
+        assert(max(value) == (begin == end ? INT_MIN : *std::max_element(expected.begin() + begin, expected.begin() + end)));
+    }
+
+    // seek by the running sum instead of the index
+    long target = sum(tree.summary()) / 2;
+    size_t index = tree.seek([&](const SummaryTree::Value& value) {
+        return sum(value) > target;
+    });
+
+    assert(std::accumulate(expected.begin(), expected.begin() + index, 0L) <= target);
+    assert(std::accumulate(expected.begin(), expected.begin() + index + 1, 0L) > target);
+    assert(tree.seek([](const SummaryTree::Value&) { return false; }) == tree.size());
+}
+
+void testTreeLines() {
+    typedef Rope::Rope<char, 16, Rope::Summary::Lines, Rope::HeapAllocator> LineTree;
+
+    std::mt19937 random(5);
+    std::string expected;
+    LineTree tree;
+
+    for (int i = 0; i < 500; i++) {
+        std::string line(random() % 40, 'a' + i % 26);
+
+        if (random() % 4 != 0) {
+            line += '\n';
+        }
+
+        size_t index = random() % (expected.size() + 1);
+
+        expected.insert(index, line);
+        tree.insert(LineTree(line.size(), line.data()), index);
+    }
+
+    std::vector<size_t> starts = {0};
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (expected[i] == '\n') {
+            starts.push_back(i + 1);
+        }
+    }
+
+    assert(tree.lineCount() == starts.size());
+    assert(tree.lineStart(starts.size()) == tree.size());
+
+    for (size_t line = 0; line < starts.size(); line++) {
+        assert(tree.lineStart(line) == starts[line]);
+        assert(tree.indexOf(line, 0) == starts[line]);
+    }
+
+    for (size_t index = 0; index <= expected.size(); index += 7) {
+        size_t line = std::upper_bound(starts.begin(), starts.end(), index) - starts.begin() - 1;
+
+        assert(tree.lineOf(index) == line);
+        assert(tree.lineColumn(index) == std::make_pair(line, index - starts[line]));
+    }
+
+    auto rope = Util::Rope<char, Rope::Summary::Lines>::copy(5, const_cast<char*>("a\nb\nc"));
+
+    assert(rope.lineCount() == 3);
+    assert(rope.lineStart(2) == 4);
+    assert(rope.lineColumn(3) == std::make_pair(size_t(1), size_t(1)));
+}
+
+void testTreeHash() {
+    typedef Rope::Rope<char, 16, Rope::Summary::Hash, Rope::HeapAllocator> HashTree;
+
+    std::mt19937 random(6);
+    std::string expected;
+    HashTree pieces;
+
+    for (int i = 0; i < 300; i++) {
+        std::string piece(random() % 20, 'a' + random() % 3);
+        size_t index = random() % (expected.size() + 1);
+
+        expected.insert(index, piece);
+        pieces.insert(HashTree(piece.size(), piece.data()), index);
+    }
+
+    HashTree whole(expected.size(), expected.data());
+
+    // equal data hashes equal regardless of the shape of the trees
+    assert(pieces == whole);
+    assert(pieces.mismatch(whole) == expected.size());
+    assert(pieces.compare(whole) == 0);
+
+    for (int i = 0; i < 100; i++) {
+        size_t begin = random() % expected.size();
+        size_t end = begin + random() % (expected.size() - begin + 1);
+        HashTree range(end - begin, expected.data() + begin);
+
+        assert(pieces.hash(begin, end) == range.hash(0, range.size()));
+        assert(whole.hash(begin, end) == range.hash(0, range.size()));
+    }
+
+    std::string repeated = "abcabc";
+    HashTree twice(repeated.size(), repeated.data());
+
+    assert(twice.hash(0, 3) == twice.hash(3, 6));
+    assert(twice.hash(0, 3) != twice.hash(1, 4));
+    assert(twice.hash(0, 0) != twice.hash(0, 1));
+
+    for (int i = 0; i < 100; i++) {
+        std::string changed = expected;
+        size_t index = random() % changed.size();
+
+        changed[index] = 'a' + random() % 4;
+
+        if (random() % 4 == 0) {
+            changed.resize(index);
+        }
+
+        HashTree other(changed.size(), changed.data());
+        size_t mismatch = std::mismatch(expected.begin(), expected.end(), changed.begin(), changed.end()).first - expected.begin();
+        int compare = expected.compare(changed);
+
+        assert(pieces.mismatch(other) == mismatch);
+        assert(other.mismatch(pieces) == mismatch);
+        assert((pieces.compare(other) < 0) == (compare < 0));
+        assert((pieces.compare(other) > 0) == (compare > 0));
+        assert((pieces == other) == (compare == 0));
+    }
+
+    // bytes of 0x80 and above are negative chars, which must not hash like small bytes
+    for (int low = 0; low < 8; low++) {
+        char small[] = {'a', 'b', char(low), 'z'};
+        char high[] = {'a', 'b', char(0xF8 + low), 'z'};
+        HashTree left(4, small);
+        HashTree right(4, high);
+
+        assert(left.hash(2, 3) != right.hash(2, 3));
+        assert(!(left == right));
+        assert(left.mismatch(right) == 2);
+    }
+
+    // a copy shares its subtrees with the original, the changed leaf is still compared
+    HashTree copy = pieces;
+    size_t changed = expected.size() / 3;
+
+    copy[changed] = 'z';
+
+    assert(copy.mismatch(pieces) == changed);
+    assert(pieces.mismatch(copy) == changed);
+    assert(!(copy == pieces));
+    assert(copy.compare(pieces) > 0);
+
+    copy[changed] = expected[changed];
+
+    assert(copy == pieces);
+    assert(copy == whole);
+
+    HashTree empty;
+
+    assert(empty == HashTree());
+    assert(empty.compare(pieces) < 0);
+    assert(pieces.compare(empty) > 0);
+}
+
+void testTreeStats() {
+    typedef Rope::Rope<char, 16, Rope::Summary::None, Rope::HeapAllocator> StatsTree;
+
+    std::string text(1000, 'x');
+    StatsTree tree(text.size(), text.data());
+    Rope::Stats stats = tree.stats();
+    size_t leaves = 0;
+
+    tree.forEachChunk(0, tree.size(), [&](std::span<const char>) {
+        leaves++;
+    });
+
+    assert(stats.height == tree.height());
+    assert(stats.leaves == leaves);
+    assert(stats.nodes == 2 * leaves - 1);
+    assert(stats.live == text.size());
+    assert(stats.used > stats.live);
+    assert(stats.shared == 0);
+    assert(std::accumulate(stats.fill.begin(), stats.fill.end(), size_t(0)) == leaves);
+
+    StatsTree copy = tree;
+
+    assert(tree.stats().shared == 1);
+
+    Rope::Counters& counters = Rope::Counters::global();
+    counters.reset();
+
+    char word[] = "abc";
+
+    for (int i = 0; i < 100; i++) {
+        tree.insert(StatsTree(3, word), (i * 37) % tree.size());
+    }
+
+    assert(counters.splits > 0);
+    assert(counters.allocations > 0);
+    assert(counters.rotations > 0);
+
+    counters.reset();
+
+    const StatsTree& constant = tree;
+    char sink = 0;
+
+    for (size_t i = 0; i < tree.size(); i += 10) {
+        sink += constant[i];
+    }
+
+    assert(sink != 0);
+    assert(counters.lookups == (tree.size() + 9) / 10);
+    assert(counters.visits >= counters.lookups * (tree.height() / 2 + 1));
+    assert(counters.visits <= counters.lookups * (tree.height() + 1));
+
+    for (size_t i = 0; i < tree.size(); i++) {
+        tree.remove(i, i + 1);
+    }
+
+    assert(counters.merges > 0);
+
+    Util::Rope<char> rope = Util::Rope<char>::copy(text.size(), text.data());
+
+    assert(rope.stats().live == text.size());
+    assert(rope.stats().leaves == (text.size() + 1023) / 1024);
+}
+
+void testConcurrent() {
+    typedef Rope::Rope<char, 16, Rope::Summary::None, Rope::HeapAllocator> SharedTree;
+
+    Rope::Concurrent<SharedTree> concurrent{SharedTree()};
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+
+    // every published version holds the first n letters of the alphabet repeated
+    for (int i = 0; i < 3; i++) {
+        readers.emplace_back([&] {
+            size_t last = 0;
+
+            while (!done.load()) {
+                SharedTree snapshot = concurrent.snapshot();
+                size_t index = 0;
+
+                assert(snapshot.size() >= last);
+                last = snapshot.size();
+
+                for (char c : snapshot) {
+                    assert(size_t(c) == 'a' + index++ % 26);
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < 2000; i++) {
+        concurrent.update([i](SharedTree& tree) {
+            char next = 'a' + tree.size() % 26;
+
+            if (i % 3 == 0 && tree.size() > 0) {
+                // rewrite the last letter to edit inside a leaf the readers share
+                char last = 'a' + (tree.size() - 1) % 26;
+
+                tree.remove(tree.size() - 1, tree.size());
+                tree.append(SharedTree(1, &last));
+            }
+
+            tree.append(SharedTree(1, &next));
+        });
+    }
+
+    done = true;
+
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    SharedTree last = concurrent.snapshot();
+
+    assert(last.size() == 2000);
+    assert(last.at(1999) == 'a' + 1999 % 26);
+
+    concurrent.reclaim();
+    assert(concurrent.pending() == 0);
+
+    // a snapshot stays valid after the concurrent rope is gone
+    SharedTree kept = last;
+    {
+        Rope::Concurrent<Util::Rope<char>> rope(Util::Rope<char>::move(3, heap("abc")));
+
+        rope.update([](Util::Rope<char>& writer) {
+            writer.erase(0, 1);
+        });
+
+        Util::Rope<char> snapshot = rope.snapshot();
+        ASSERT_DATA(snapshot, "bc");
+    }
+
+    assert(kept.size() == 2000);
+}
+
+void testHistory() {
+    typedef Rope::Rope<char, 64, Rope::Summary::None, Rope::HeapAllocator> HistoryTree;
+
+    auto content = [](const HistoryTree& tree) {
+        return std::string(tree.begin(), tree.end());
+    };
+
+    std::mt19937 random(8);
+    std::string text(100000, 'x');
+    std::vector<std::string> expected = {text};
+    Rope::History<HistoryTree> history(HistoryTree(text.size(), text.data()));
+    size_t base = history.memory();
+
+    assert(base >= text.size());
+
+    for (int i = 0; i < 100; i++) {
+        size_t index = random() % text.size();
+        char c = 'a' + i % 26;
+
+        text.insert(index, 1, c);
+        expected.push_back(text);
+
+        history.edit([&](HistoryTree& tree) {
+            tree.insert(HistoryTree(1, &c), index);
+        });
+    }
+
+    // every step only keeps the copied path, far less than a copy of the document
+    assert(history.memory() - base < 100 * 64 * 64);
+    assert(history.undoCount() == 100);
+    assert(history.redoCount() == 0);
+
+    for (int i = 100; i > 0; i--) {
+        assert(history.undo());
+    }
+
+    assert(!history.undo());
+    assert(content(history.current()) == expected[0]);
 
-int main(int argc, char** argv) {
-    Rope::Rope<char> tree;
-    tree.append(Rope::Rope<char>());
+    for (int i = 1; i <= 100; i++) {
+        assert(history.redo());
+        assert(content(history.current()) == expected[i]);
+    }
+
+    assert(!history.redo());
+
+    // recording after an undo drops the versions to redo
+    history.undo();
+    history.undo();
+    history.edit([](HistoryTree& tree) {
+        tree.remove(0, 10);
+    });
+
+    assert(history.redoCount() == 0);
+    assert(content(history.current()) == expected[98].substr(10));
+
+    // dropping the oldest versions only frees what they do not share
+    Rope::History<HistoryTree> limited(HistoryTree(text.size(), text.data()), Rope::History<HistoryTree>::Unlimited, 10);
+
+    for (int i = 0; i < 50; i++) {
+        limited.edit([&](HistoryTree& tree) {
+            tree.remove(i * 100, i * 100 + 1);
+        });
+    }
+
+    assert(limited.undoCount() == 10);
+    assert(limited.memory() >= limited.current().stats().used / 2);
+    assert(limited.memory() < 2 * limited.current().stats().used);
+
+    size_t memory = limited.memory();
+    Rope::History<HistoryTree> small(HistoryTree(text.size(), text.data()), memory / 2);
+
+    for (int i = 0; i < 10; i++) {
+        small.edit([&](HistoryTree& tree) {
+            tree.remove(i, i + 1);
+        });
+    }
+
+    assert(small.undoCount() == 0);
+    assert(small.current().size() == text.size() - 10);
+
+    Rope::History<Util::Rope<char>> rope(Util::Rope<char>::move(3, heap("abc")));
+
+    rope.edit([](Util::Rope<char>& current) {
+        current.erase(0, 1);
+    });
+
+    ASSERT_DATA(rope.current(), "bc");
+    rope.undo();
+    ASSERT_DATA(rope.current(), "abc");
+}
+
+void testTreeUtf8() {
+    typedef Rope::Summary::Tuple<Rope::Summary::Codepoints, Rope::Summary::Utf16> Utf8;
+    typedef Rope::Rope<char, 16, Utf8, Rope::HeapAllocator> Utf8Tree;
+
+    // one, two, three and four byte sequences
+    const char* sequences[] = {"a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+    std::mt19937 random(10);
+    std::string text;
+    std::vector<size_t> starts;
+    std::vector<size_t> units;
+    size_t unit = 0;
+
+    for (int i = 0; i < 500; i++) {
+        const char* sequence = sequences[random() % 4];
+        size_t length = strlen(sequence);
+
+        starts.push_back(text.size());
+        units.push_back(unit);
+
+        text += sequence;
+        unit += length == 4 ? 2 : 1;
+    }
+
+    Utf8Tree tree(text.size(), text.data());
+
+    assert(tree.codepointCount() == starts.size());
+    assert(tree.utf16Count() == unit);
+    assert(tree.indexOfCodepoint(starts.size()) == tree.size());
+    assert(tree.indexOfUtf16(unit) == tree.size());
+
+    for (size_t i = 0; i < starts.size(); i++) {
+        assert(tree.indexOfCodepoint(i) == starts[i]);
+        assert(tree.codepointOf(starts[i]) == i);
+        assert(tree.utf16Of(starts[i]) == units[i]);
+        assert(tree.indexOfUtf16(units[i]) == starts[i]);
+
+        // the second unit of a surrogate pair belongs to the same codepoint
+        if (i + 1 < starts.size() && units[i + 1] - units[i] == 2) {
+            assert(tree.indexOfUtf16(units[i] + 1) == starts[i]);
+        }
+    }
+
+    // edits inside a sequence move to its start
+    for (int i = 0; i < 200; i++) {
+        size_t index = random() % (tree.size() + 1);
+        size_t start = index;
+
+        while (start > 0 && start < text.size() && (static_cast<uint8_t>(text[start]) & 0xC0) == 0x80) {
+            start--;
+        }
+
+        if (i % 2 == 0) {
+            const char* sequence = sequences[random() % 4];
+
+            text.insert(start, sequence);
+            tree.insert(Utf8Tree(strlen(sequence), const_cast<char*>(sequence)), index);
+        } else {
+            size_t end = std::min(start + 1 + random() % 8, text.size());
+
+            while (end < text.size() && (static_cast<uint8_t>(text[end]) & 0xC0) == 0x80) {
+                end++;
+            }
+
+            text.erase(start, end - start);
+            tree.remove(index, end);
+        }
+    }
+
+    assert(std::string(tree.begin(), tree.end()) == text);
+
+    size_t count = tree.codepointCount();
+    size_t codepoint = 100;
+
+    while (tree.indexOfCodepoint(codepoint + 1) - tree.indexOfCodepoint(codepoint) == 1) {
+        codepoint++;
+    }
+
+    // a split inside a sequence keeps it whole on the right
+    size_t start = tree.indexOfCodepoint(codepoint);
+    auto [left, right] = tree.split(start + 1);
+
+    assert(left.size() == start);
+    assert(left.codepointCount() == codepoint);
+    assert(left.codepointCount() + right.codepointCount() == count);
+    assert((static_cast<uint8_t>(right.at(0)) & 0xC0) != 0x80);
+
+    // batched edits inside a sequence move to its start as well
+    std::string grin = "ab\xF0\x9F\x98\x80" "cd\xF0\x9F\x98\x80" "ef";
+    Utf8Tree batched(grin.size(), grin.data());
+    Utf8Tree::Edit cuts[] = {{3, 0, std::span<const char>("x", 1)}, {7, 3, std::span<const char>("y", 1)}, {12, 1, {}}};
+
+    batched.apply(cuts);
+    assert(std::string(batched.begin(), batched.end()) == "abx\xF0\x9F\x98\x80" "cy\xF0\x9F\x98\x80" "f");
+    assert(batched.codepointCount() == 8);
+
+    // across many leaves the ends are aligned on the way down, compared with aligning the reference up front
+    std::string mixed;
+
+    for (int i = 0; i < 300; i++) {
+        mixed += i % 3 == 0 ? "a\xF0\x9F\x98\x80" : i % 3 == 1 ? "\xC3\xA9" : "\xE2\x82\xAC";
+    }
+
+    Utf8Tree spread(mixed.size(), mixed.data());
+    std::vector<Utf8Tree::Edit> spreadEdits;
+
+    auto aligned = [&mixed](size_t index) {
+        for (int i = 0; i < 3 && index > 0 && index < mixed.size() && (static_cast<uint8_t>(mixed[index]) & 0xC0) == 0x80; i++) {
+            index--;
+        }
+
+        return index;
+    };
+
+    for (size_t index = 1; index + 5 < mixed.size(); index += 7 + random() % 20) {
+        spreadEdits.push_back({index, random() % 5, std::span<const char>("#", random() % 2)});
+        index += spreadEdits.back().remove;
+    }
+
+    for (auto it = spreadEdits.rbegin(); it != spreadEdits.rend(); it++) {
+        size_t first = aligned(it->index);
+        size_t last = aligned(it->index + it->remove);
+
+        mixed.replace(first, last - first, it->insert.data(), it->insert.size());
+    }
+
+    spread.apply(spreadEdits);
+    assert(std::string(spread.begin(), spread.end()) == mixed);
+
+    // cursor edits inside a sequence move to its start as well, inside a leaf and across leaves
+    std::string emoji = "ab\xF0\x9F\x98\x80" "cd";
+    std::string large(40, 'z');
+    Utf8Tree edited(emoji.size(), emoji.data());
+    Utf8Tree::Cursor cursor = edited.cursor(4);
+
+    cursor.insert('x');
+    assert(cursor.index() == 3);
+
+    cursor.seek(5);
+    cursor.insert(large.data(), large.size());
+    assert(cursor.index() == 3 + large.size());
+
+    cursor.seek(3 + large.size() + 2);
+    cursor.remove(3);
+    assert(cursor.index() == 3 + large.size());
+
+    assert(std::string(edited.begin(), edited.end()) == "abx" + large + "d");
+    assert(edited.codepointCount() == edited.size());
+
+    Util::Rope<char, Utf8> rope = Util::Rope<char, Utf8>::copy(text.size(), text.data());
+
+    assert(rope.codepointCount() == count);
+    assert(rope.utf16Of(rope.size()) == rope.utf16Count());
+}
+
+void testTreeApply() {
+    std::mt19937 random(17);
+    std::string expected(20000, 'a');
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = 'a' + i % 26;
+    }
+
+    SmallTree tree(expected.size(), expected.data());
+    SmallTree snapshot = tree;
+    std::vector<std::string> inserts;
+
+    for (int round = 0; round < 20; round++) {
+        std::vector<SmallTree::Edit> edits;
+        size_t index = 0;
+
+        inserts.clear();
+        inserts.reserve(200);
+
+        while (edits.size() < 200) {
+            index += random() % 150;
+
+            if (index > expected.size()) {
+                break;
+            }
+
+            size_t remove = std::min<size_t>(random() % 40, expected.size() - index);
+            inserts.push_back(std::string(random() % 50, 'A' + random() % 26));
+            edits.push_back({index, remove, inserts.back()});
+
+            index += remove;
+        }
+
+        // the reference applies the edits from the back
+        for (auto it = edits.rbegin(); it != edits.rend(); it++) {
+            expected.replace(it->index, it->remove, it->insert.data(), it->insert.size());
+        }
+
+        tree.apply(edits);
+
+        ASSERT_TEXT(tree, expected);
+        assert(tree.height() <= 2 * std::log2(tree.size() / 2 + 2) + 2);
+    }
+
+    assert(text(snapshot).size() == 20000);
+
+    SmallTree::Edit all[] = {{0, tree.size(), {}}};
+    tree.apply(all);
+    ASSERT_TEXT(tree, "");
+
+    auto rope = Util::Rope<char>::copy(11, const_cast<char*>("hello world"));
+    std::string big = "big ";
+    Util::Rope<char>::Edit edits[] = {{0, 1, std::span<const char>("H", 1)}, {6, 0, big}, {11, 0, std::span<const char>("!", 1)}};
+
+    rope.apply(edits);
+    ASSERT_DATA(rope, "Hello big world!");
+}
+
+void testTreeBalance() {
+    SmallTree tree;
+
+    for (int i = 0; i < 10000; i++) {
+        tree.append(make<SmallTree>("abcdefgh"));
+    }
+
+    // an AVL tree with n leaves has a height of at most 1.44 log2(n)
+    ASSERT_SIZE(tree, 80000);
+    assert(tree.height() <= 20);
+    assert(tree[79999] == 'h');
+
+    for (int i = 0; i < 10000; i++) {
+        tree.insert(make<SmallTree>("x"), 0);
+    }
+
+    assert(tree.height() <= 21);
+    assert(tree[0] == 'x' && tree[10000] == 'a');
+}
+
+void testTreeBuild() {
+    std::string data(10000, 'a');
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    // 1250 full leaves are built into a perfectly balanced tree
+    SmallTree tree(data.size(), data.data());
+
+    ASSERT_TEXT(tree, data);
+    assert(tree.height() == 11);
+
+    // the leaves of an uneven size are filled evenly
+    SmallTree uneven(data.size() - 3, data.data());
+
+    ASSERT_TEXT(uneven, data.substr(0, data.size() - 3));
+    assert(uneven.height() == 11);
+
+    std::string large(3 << 20, 'x');
+    large[12345] = 'y';
+
+    Tree parallel(large.size(), large.data(), 4);
+
+    ASSERT_SIZE(parallel, large.size());
+    assert(parallel.find('y') == 12345);
+    assert(parallel.height() == 12);
+
+    auto rope = Util::Rope<char>::copy(large.size(), large.data(), 2);
+
+    ASSERT_SIZE(rope, large.size());
+    assert(rope.at(12345) == 'y');
+}
+
+void testTreeMap() {
+    std::string data(1000, 'a');
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    char path[] = "/tmp/rope-test-XXXXXX";
+    int file = mkstemp(path);
+
+    assert(file >= 0);
+    assert(write(file, data.data(), data.size()) == ssize_t(data.size()));
+    close(file);
+
+    {
+        SmallTree tree = SmallTree::map(path);
+        SmallTree snapshot = tree;
+        size_t mapped = tree.stats().mapped;
+
+        ASSERT_TEXT(tree, data);
+
+        // reading through a non-const rope leaves the leaves mapped
+        std::string read;
+
+        for (char c : tree) {
+            read += c;
+        }
+
+        for (size_t i = 0; i < tree.size(); i += 7) {
+            assert(tree[i] == data[i] && tree.at(i) == data[i]);
+        }
+
+        assert(read == data);
+        assert(mapped > 0 && tree.stats().mapped == mapped);
+
+        // modifying a mapped leaf copies it, the mapping stays untouched
+        tree[3] = 'X';
+        tree.insert(make<SmallTree>("123"), 500);
+        tree.remove(10, 20);
+
+        std::string expected = data;
+
+        expected[3] = 'X';
+        expected.insert(500, "123");
+        expected.erase(10, 10);
+
+        ASSERT_TEXT(tree, expected);
+        ASSERT_TEXT(snapshot, data);
+
+        auto [left, right] = snapshot.split(333);
+
+        ASSERT_TEXT(left, data.substr(0, 333));
+        ASSERT_TEXT(right, data.substr(333));
+    }
+
+    auto rope = Util::Rope<char>::map(path);
+    ASSERT_SIZE(rope, data.size());
+
+    unlink(path);
+
+    bool thrown = false;
+
+    try {
+        SmallTree::map(path);
+    } catch (const std::system_error& error) {
+        thrown = true;
+    }
+
+    assert(thrown);
+}
+
+void testTreeWrite() {
+    std::string data(10000, 'a');
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    // 1250 leaves need more than one batch of vectored writes
+    SmallTree tree(data.size(), data.data());
+
+    char path[] = "/tmp/rope-test-XXXXXX";
+    int file = mkstemp(path);
+
+    assert(file >= 0);
+    tree.writeTo(file);
+
+    std::string written(data.size(), '\0');
+
+    assert(pread(file, written.data(), written.size(), 0) == ssize_t(data.size()));
+    assert(written == data);
+
+    close(file);
+    unlink(path);
+
+    auto rope = Util::Rope<char>::copy(data.size(), data.data());
+    std::ostringstream oss;
+
+    oss << rope;
+    assert(oss.str() == data);
+}
+
+void testTreeBuilder() {
+    std::mt19937 random(13);
+    std::string data(10000, 'a');
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 'a' + random() % 26;
+    }
+
+    SmallTree::Builder builder;
+
+    for (size_t index = 0; index < data.size();) {
+        size_t size = std::min<size_t>(random() % 30, data.size() - index);
+
+        builder.append(data.data() + index, size);
+        index += size;
+    }
+
+    SmallTree tree = builder.build();
+
+    ASSERT_TEXT(tree, data);
+    assert(tree.height() <= 12);
+    ASSERT_TEXT(builder.build(), "");
+
+    std::istringstream is(data.substr(0, 1003));
+    builder.read(is);
+    ASSERT_TEXT(builder.build(), data.substr(0, 1003));
+
+    int pipes[2];
+    assert(pipe(pipes) == 0);
+
+    // the pipe returns short reads that end in the middle of a leaf
+    std::thread writer([&] {
+        for (size_t index = 0; index < data.size(); index += 777) {
+            size_t size = std::min<size_t>(777, data.size() - index);
+            assert(write(pipes[1], data.data() + index, size) == ssize_t(size));
+        }
+
+        close(pipes[1]);
+    });
+
+    builder.append("xyz", 3);
+    builder.read(pipes[0]);
+    writer.join();
+    close(pipes[0]);
+
+    ASSERT_TEXT(builder.build(), "xyz" + data);
+
+    std::istringstream stream("hello world");
+    auto rope = Util::Rope<char>::read(stream);
+
+    ASSERT_DATA(rope, "hello world");
+}
+
+void testTreeRandom() {
+    std::mt19937 random(42);
+    std::string expected;
+    SmallTree tree;
+    std::vector<std::pair<SmallTree, std::string>> snapshots;
+
+    for (int i = 0; i < 2000; i++) {
+        size_t index = random() % (expected.size() + 1);
+
+        switch (random() % 3) {
+        case 0: {
+            std::string str(random() % 20, 'a' + random() % 26);
+
+            expected.insert(index, str);
+            tree.insert(make<SmallTree>(str.c_str()), index);
+            break;
+        }
+        case 1: {
+            size_t end = index + random() % 30;
+            end = std::min(end, expected.size());
+
+            expected.erase(index, end - index);
+            tree.remove(index, end);
+            break;
+        }
+        case 2: {
+            auto [left, right] = tree.split(index);
+
+            ASSERT_TEXT(left, expected.substr(0, index));
+            ASSERT_TEXT(right, expected.substr(index));
+
+            left.append(std::move(right));
+            tree = std::move(left);
+            break;
+        }
+        }
+
+        ASSERT_SIZE(tree, expected.size());
+
+        if (i % 100 == 0) {
+            snapshots.emplace_back(tree, expected);
+        }
+    }
+
+    ASSERT_TEXT(tree, expected);
+
+    for (auto& [snapshot, content] : snapshots) {
+        ASSERT_TEXT(snapshot, content);
+    }
+
+    std::string iterated;
+
+    for (char c : tree) {
+        iterated += c;
+    }
+
+    assert(iterated == expected);
+}
+
+void testPoolReuse() {
+    typedef Rope::Pool<64> Pool;
+
+    void* first = Pool::allocate();
+    Pool::deallocate(first);
+
+    void* second = Pool::allocate();
+    assert(first == second);
+
+    void* chunks[1000];
+
+    for (void*& chunk : chunks) {
+        chunk = Pool::allocate();
+        std::memset(chunk, 0xff, 64);
+    }
+
+    for (void* chunk : chunks) {
+        Pool::deallocate(chunk);
+    }
+
+    Pool::deallocate(second);
+}
+
+void testTreeAllocator() {
+    typedef Rope::Rope<std::string, 8, Rope::Summary::None, Rope::HeapAllocator> HeapTree;
+    typedef Rope::Rope<std::string, 8, Rope::Summary::None, Rope::PoolAllocator<0>> PoolTree;
+
+    std::string words[] = {"a", "long string that does not fit inline", "c"};
+
+    HeapTree heap(3, words);
+    PoolTree pool(3, words);
+
+    heap.append(HeapTree(3, words));
+    pool.append(PoolTree(3, words));
+
+    assert(heap[4] == words[1]);
+    assert(pool[4] == words[1]);
+
+    // edits rebuild the leaves element by element, which works for data that is not trivially copyable
+    std::string replaced[] = {"x", "another string that does not fit inline"};
+    HeapTree::Edit edits[] = {{1, 1, replaced}, {4, 2, {}}};
+
+    heap.apply(edits);
+
+    assert(heap.size() == 5);
+    assert(heap[1] == "x");
+    assert(heap[2] == replaced[1]);
+    assert(heap[4] == words[0]);
+}
+
+void testBTree() {
+    typedef Rope::BTree<char, 8, 4, Rope::HeapAllocator> SmallBTree;
+
+    std::mt19937 random(7);
+    std::string expected;
+    SmallBTree tree;
+
+    for (int i = 0; i < 3000; i++) {
+        size_t index = random() % (expected.size() + 1);
+
+        switch (random() % 4) {
+        case 0:
+        case 1: {
+            std::string str(random() % 40, 'a' + random() % 26);
+
+            expected.insert(index, str);
+            tree.insert(SmallBTree(str.size(), str.data()), index);
+            break;
+        }
+        case 2: {
+            size_t end = std::min(index + random() % 30, expected.size());
+
+            expected.erase(index, end - index);
+            tree.remove(index, end);
+            break;
+        }
+        case 3: {
+            auto [left, right] = tree.split(index);
+
+            left.append(std::move(right));
+            tree = std::move(left);
+            break;
+        }
+        }
+
+        ASSERT_SIZE(tree, expected.size());
+
+        if (!expected.empty()) {
+            size_t probe = random() % expected.size();
+            assert(tree[probe] == expected[probe]);
+        }
+    }
+
+    ASSERT_TEXT(tree, expected);
+
+    // every inner node has at least two children
+    size_t leaves = 0;
+
+    tree.forEachChunk(0, tree.size(), [&](std::span<const char>) {
+        leaves++;
+    });
+
+    assert((size_t(1) << tree.height()) <= leaves);
+
+    std::string chunks;
+
+    tree.forEachChunk(5, 500, [&](std::span<const char> chunk) {
+        chunks.append(chunk.data(), chunk.size());
+    });
+
+    assert(chunks == expected.substr(5, 495));
+
+    SmallBTree copy = tree;
+    copy[0] = '#';
+
+    assert(tree[0] == expected[0] && copy[0] == '#');
+
+    std::string large(1 << 20, 'x');
+    large[777777] = 'y';
+
+    Rope::BTree<char> wide(large.size(), large.data());
+
+    assert(wide.height() == 3);
+    assert(wide[777777] == 'y' && wide[777776] == 'x');
+}
+
+size_t fibonacci(Rope::ThreadPool& pool, size_t n) {
+    if (n < 2) {
+        return n;
+    }
+
+    size_t left;
+    size_t right;
+
+    pool.invoke([&] { left = fibonacci(pool, n - 1); }, [&] { right = fibonacci(pool, n - 2); });
+    return left + right;
+}
+
+void testTreeParallel() {
+    Rope::ThreadPool pool(3);
+    Rope::ThreadPool inline_(0);
+
+    assert(fibonacci(pool, 20) == 6765);
+    assert(fibonacci(inline_, 10) == 55);
+
+    std::mt19937 random(19);
+    std::string data(5 << 20, 'a');
+
+    for (char& c : data) {
+        c = 'a' + random() % 26;
+    }
+
+    Tree tree(data.size(), data.data());
+    char* array = tree.parallelArray(pool);
+
+    assert(std::string(array, data.size()) == data);
+    delete[] array;
+
+    std::string part(3 << 20, '\0');
+    tree.parallelCopy(12345, 12345 + part.size(), part.data(), pool);
+    assert(part == data.substr(12345, part.size()));
+
+    auto sum = [](std::span<const char> chunk) {
+        return std::accumulate(chunk.begin(), chunk.end(), size_t(0));
+    };
+    auto add = [](size_t left, size_t right) {
+        return left + right;
+    };
+
+    assert(tree.parallelReduce(0, tree.size(), size_t(0), sum, add, pool) == std::accumulate(data.begin(), data.end(), size_t(0)));
+    assert(tree.parallelReduce(7, 7, size_t(42), sum, add, pool) == 42);
+
+    // the results are combined in the order of the chunks
+    auto copy = [](std::span<const char> chunk) {
+        return std::string(chunk.data(), chunk.size());
+    };
+    auto concat = [](const std::string& left, const std::string& right) {
+        return left + right;
+    };
+
+    assert(tree.parallelReduce(0, tree.size(), std::string(), copy, concat, pool) == data);
+
+    // the results need no default constructor
+    struct Count {
+        size_t value;
+
+        explicit Count(size_t value) : value(value) {}
+    };
+
+    auto count = [](std::span<const char> chunk) {
+        return Count(chunk.size());
+    };
+    auto merge = [](Count left, Count right) {
+        return Count(left.value + right.value);
+    };
+
+    assert(tree.parallelReduce(0, tree.size(), Count(0), count, merge, pool).value == data.size());
+
+    std::atomic<size_t> total = 0;
+    std::atomic<size_t> mismatches = 0;
+
+    tree.parallelForEachChunk(100, tree.size() - 100, [&](std::span<const char> chunk, size_t index) {
+        total += chunk.size();
+
+        if (std::string_view(chunk.data(), chunk.size()) != std::string_view(data).substr(index, chunk.size())) {
+            mismatches++;
+        }
+    }, pool);
+
+    assert(total == data.size() - 200 && mismatches == 0);
+
+    auto rope = Util::Rope<char>::copy(data.size(), data.data());
+    array = rope.parallelArray();
+
+    assert(std::string(array, data.size()) == data);
+    delete[] array;
+}
+
+/// The heap allocator counting its allocations
+struct CountingAllocator : Rope::HeapAllocator {
+    static inline size_t count = 0;
+
+    template <typename T>
+    static T* create() {
+        count++;
+        return HeapAllocator::create<T>();
+    }
+
+    template <typename T, size_t TCount>
+    static T* allocate() {
+        count++;
+        return HeapAllocator::allocate<T, TCount>();
+    }
+};
+
+void testTreeInline() {
+    typedef Rope::Rope<char, 16, Rope::Summary::None, CountingAllocator> CountingTree;
+
+    CountingAllocator::count = 0;
+
+    // empty, moved-from and small ropes never allocate
+    CountingTree empty;
+    CountingTree small = make<CountingTree>("hello");
+    CountingTree moved = std::move(small);
+    CountingTree copy = moved;
+
+    copy.append(make<CountingTree>(" world"));
+    copy.insert(make<CountingTree>(","), 5);
+    copy.remove(0, 1);
+
+    auto [left, right] = copy.split(4);
+
+    assert(CountingAllocator::count == 0);
+    ASSERT_TEXT(empty, "");
+    ASSERT_TEXT(small, "");
+    ASSERT_TEXT(moved, "hello");
+    ASSERT_TEXT(copy, "");
+    ASSERT_TEXT(left, "ello");
+    ASSERT_TEXT(right, ", world");
+
+    // a rope grows into a tree and shrinks back inline
+    std::string expected = "ello";
+
+    for (int i = 0; i < 10; i++) {
+        left.append(make<CountingTree>("abcdefgh"));
+        expected += "abcdefgh";
+    }
+
+    left.insert(std::move(right), 4);
+    expected.insert(4, ", world");
+
+    assert(CountingAllocator::count > 0);
+    ASSERT_TEXT(left, expected);
+
+    left.remove(3, left.size() - 3);
+    CountingAllocator::count = 0;
+
+    CountingTree shrunk = left;
+    shrunk[0] = 'E';
+
+    assert(CountingAllocator::count == 0);
+    ASSERT_TEXT(shrunk, "Ellfgh");
+    ASSERT_TEXT(left, "ellfgh");
+}
+
+void testTreeCursor() {
+    typedef Rope::Rope<char, 64, Rope::Summary::Lines, CountingAllocator> LineTree;
+
+    std::mt19937 random(11);
+    std::string expected(5000, 'a');
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = i % 50 == 49 ? '\n' : 'a' + i % 26;
+    }
+
+    const std::string original = expected;
+    LineTree tree(expected.size(), expected.data());
+    LineTree snapshot = tree;
+    LineTree::Cursor cursor = tree.cursor(1234);
+
+    assert(cursor.get() == expected[1234]);
+
+    // typing and deleting near the cursor
+    for (int i = 0; i < 2000; i++) {
+        size_t index = cursor.index();
+
+        switch (random() % 4) {
+        case 0:
+        case 1: {
+            char value = random() % 8 == 0 ? '\n' : 'A' + random() % 26;
+
+            expected.insert(index, 1, value);
+            cursor.insert(value);
+            break;
+        }
+        case 2:
+            expected.erase(index, 1);
+            cursor.remove(1);
+            break;
+        case 3:
+            cursor.seek(index + random() % 200 - 100);
+            break;
+        }
+
+        assert(cursor.index() <= expected.size());
+        ASSERT_SIZE(tree, expected.size());
+    }
+
+    ASSERT_TEXT(tree, expected);
+    assert(tree.lineCount() == size_t(std::count(expected.begin(), expected.end(), '\n')) + 1);
+    ASSERT_TEXT(snapshot, original);
+
+    // typing within a leaf does not allocate
+    cursor.seek(100);
+    cursor.remove(20);
+    expected.erase(100, 20);
+    CountingAllocator::count = 0;
+
+    for (char value : std::string("typed")) {
+        cursor.insert(value);
+    }
+
+    expected.insert(100, "typed");
+
+    assert(CountingAllocator::count == 0);
+    assert(cursor.get() == expected[105]);
+    ASSERT_TEXT(tree, expected);
+
+    // the last data and the end of the rope
+    cursor.seek(tree.size() - 1);
+    assert(cursor.get() == expected.back());
+
+    cursor.seek(tree.size());
+    assert(cursor.index() == tree.size());
+
+    cursor.insert('!');
+    expected += '!';
+
+    assert(cursor.index() == expected.size());
+    cursor.seek(0);
+    cursor.seek(tree.size() - 1);
+    assert(cursor.get() == '!');
+    ASSERT_TEXT(tree, expected);
+
+    // inserting an empty rope does not allocate
+    CountingAllocator::count = 0;
+    tree.insert(LineTree(), 10);
+
+    assert(CountingAllocator::count == 0);
+    ASSERT_TEXT(tree, expected);
+
+    // a root leaf shrinking to the inline size moves inline
+    Rope::Rope<char> single(100, expected.data());
+    Rope::Rope<char>::Cursor shrink = single.cursor(10);
+
+    assert(single.stats().used > 0);
+    shrink.remove(50);
+
+    assert(single.stats().used == 0);
+    assert(shrink.get() == expected[60]);
+    ASSERT_TEXT(single, expected.substr(0, 10) + expected.substr(60, 40));
+
+    auto rope = Util::Rope<char>::copy(5, const_cast<char*>("hello"));
+    auto edit = rope.cursor(5);
+
+    edit.insert(" world", 6);
+    ASSERT_DATA(rope, "hello world");
+}
+
+int main() {
+    testEmpty();
+    testCopy();
+    testMove();
+    testAppend();
+    testSplit();
+    testInsert();
+    testIterator();
+    testPoolReuse();
+    testTreeAllocator();
+    testTreeEmpty();
+    testTreeAppend();
+    testTreeSplit();
+    testTreeInsert();
+    testTreeRemove();
+    testTreeCopy();
+    testTreeShare();
+    testTreeIterator();
+    testTreeChunks();
+    testTreeSearch();
+    testSearchKernels();
+    testTreeSummary();
+    testTreeLines();
+    testTreeHash();
+    testTreeUtf8();
+    testTreeStats();
+    testTreeApply();
+    testTreeBalance();
+    testTreeBuild();
+    testTreeInline();
+    testTreeCursor();
+    testBTree();
+    testTreeParallel();
+    testConcurrent();
+    testHistory();
+    testTreeMap();
+    testTreeWrite();
+    testTreeBuilder();
+    testTreeRandom();
+
+    std::cout << "All tests completed!" << std::endl;
+    return 0;
 }
\ No newline at end of file